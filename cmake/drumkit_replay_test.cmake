@@ -0,0 +1,31 @@
+# Runs drumkit on the scripted replay without a motor or Pure Data, as fast as it loops, and checks its hits and torque.
+# The scripted stick strikes the snare at 1.5 Hz for 10 s, reaching 0.15 m into the head at the bottom of each strike.
+# Usage: cmake -DDRUMKIT=<path to drumkit> -P drumkit_replay_test.cmake
+
+execute_process(COMMAND ${DRUMKIT} none stdout ../drum 0 "" 0 replay 0
+    OUTPUT_VARIABLE output
+    RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "drumkit exited with ${result}\n${output}")
+endif()
+
+# Hits are printed as "<drum id> <level> <sustain>;", snare 0, kick 1, hi hat 2
+string(REGEX MATCHALL "\n0 [0-9.e+-]+ [0-9.e+-]+" snare_hits "\n${output}")
+string(REGEX MATCHALL "\n[12] [0-9.e+-]+ [0-9.e+-]+" other_hits "\n${output}")
+list(LENGTH snare_hits snare_hit_count)
+list(LENGTH other_hits other_hit_count)
+if(NOT snare_hit_count EQUAL 15 OR NOT other_hit_count EQUAL 0)
+    message(FATAL_ERROR "Expected 15 snare hits and no others, got ${snare_hit_count} and ${other_hit_count}\n${output}")
+endif()
+
+if(NOT output MATCHES "Torque without a motor: ([0-9]+) commands above 0, max ([0-9.e+-]+) Nm")
+    message(FATAL_ERROR "No torque summary\n${output}")
+endif()
+set(torque_commands ${CMAKE_MATCH_1})
+set(max_torque ${CMAKE_MATCH_2})
+# 600 N/m snare spring, quadratic in the 0.15 m penetration: 13.5 Nm, less what the position filter smooths off
+if(torque_commands LESS 100 OR max_torque LESS 10 OR max_torque GREATER 15)
+    message(FATAL_ERROR "Unexpected torque: ${torque_commands} commands above 0, max ${max_torque} Nm\n${output}")
+endif()
+
+message(STATUS "${snare_hit_count} snare hits, ${torque_commands} torque commands above 0, max ${max_torque} Nm")
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+// Linear allocator for data that only lives for one frame.
+// The memory is reserved once. Allocating bumps an offset and reset() releases everything at once, so a steady-state
+// frame never reaches the heap. Destructors are never run, so only trivially destructible types may be allocated.
+class FrameArena {
+   public:
+    explicit FrameArena(size_t capacity) : m_buffer(new unsigned char[capacity]), m_capacity(capacity) {}
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Uninitialized storage for count objects of T. Throws std::bad_alloc when the arena is exhausted.
+    template <typename T>
+    T* allocate(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena never runs destructors");
+        const uintptr_t base = reinterpret_cast<uintptr_t>(m_buffer.get());
+        const uintptr_t start = (base + m_used + alignof(T) - 1) & ~uintptr_t(alignof(T) - 1);
+        const size_t end = size_t(start - base) + count * sizeof(T);
+        if (end > m_capacity) {
+            throw std::bad_alloc();
+        }
+        m_used = end;
+        m_highWater = m_used > m_highWater ? m_used : m_highWater;
+        return reinterpret_cast<T*>(start);
+    }
+
+    // Release every allocation. Anything allocated before is invalid afterwards.
+    void reset() { m_used = 0; }
+
+    size_t used() const { return m_used; }
+    size_t capacity() const { return m_capacity; }
+
+    // Most bytes in use at once since construction, for sizing the arena.
+    size_t highWater() const { return m_highWater; }
+
+   private:
+    std::unique_ptr<unsigned char[]> m_buffer;
+    size_t m_capacity;
+    size_t m_used{0};
+    size_t m_highWater{0};
+};
+
+// Fixed-capacity array whose storage comes from a FrameArena, valid until the arena is reset.
+template <typename T>
+class FrameArray {
+   public:
+    FrameArray(FrameArena& arena, size_t capacity) : m_data(arena.allocate<T>(capacity)), m_capacity(capacity) {}
+
+    FrameArray(const FrameArray&) = delete;
+    FrameArray& operator=(const FrameArray&) = delete;
+
+    // Throws std::length_error when full.
+    void push_back(const T& value) {
+        if (m_size == m_capacity) {
+            throw std::length_error("FrameArray capacity exceeded");
+        }
+        new (&m_data[m_size++]) T(value);
+    }
+
+    // Grow with value-initialized elements or shrink. Throws std::length_error past the capacity.
+    void resize(size_t size) {
+        if (size > m_capacity) {
+            throw std::length_error("FrameArray capacity exceeded");
+        }
+        for (size_t i = m_size; i < size; i++) {
+            new (&m_data[i]) T();
+        }
+        m_size = size;
+    }
+
+    void clear() { m_size = 0; }
+
+    T& operator[](size_t i) { return m_data[i]; }
+    const T& operator[](size_t i) const { return m_data[i]; }
+    T* data() { return m_data; }
+    const T* data() const { return m_data; }
+    T* begin() { return m_data; }
+    T* end() { return m_data + m_size; }
+    const T* begin() const { return m_data; }
+    const T* end() const { return m_data + m_size; }
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_capacity; }
+    bool empty() const { return m_size == 0; }
+
+   private:
+    T* m_data;
+    size_t m_capacity;
+    size_t m_size{0};
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "graphicsplugin.h"
+#include "frame_timing.h"
+
+// The projection layer a frame submits, with its views and the cubes drawn into them. Every array comes from the frame
+// arena, so composing a steady-state frame does not allocate; all of it is invalid once the arena is reset after
+// xrEndFrame. OpenXrProgram and the replay program both compose their frames with it.
+struct FrameLayer {
+    FrameLayer(FrameArena& arena, size_t viewCount, size_t cubeCapacity)
+        : layers(arena, 1), projectionViews(arena, viewCount), cubes(arena, cubeCapacity) {}
+
+    FrameLayer(const FrameLayer&) = delete;
+    FrameLayer& operator=(const FrameLayer&) = delete;
+
+    // Draw a cube of scale at location if both its position and orientation are valid.
+    void AddCube(const XrSpaceLocation& location, const XrVector3f& scale);
+
+    // Point the layer at the projection views, posed in space, and add it to the layers passed to xrEndFrame.
+    void Submit(XrSpace space);
+
+    FrameArray<XrCompositionLayerBaseHeader*> layers;
+    XrCompositionLayerProjection layer{XR_TYPE_COMPOSITION_LAYER_PROJECTION};
+    FrameArray<XrCompositionLayerProjectionView> projectionViews;
+    FrameArray<Cube> cubes;
+};
+
+// Logs the spaces a frame fails to locate when their result changes, rather than on every frame a space stays lost:
+// formatting the message allocates on the render thread.
+class LocateFailureLog {
+   public:
+    // Track count spaces, none of them failing. Allocates, so call it outside the frame loop.
+    void Reset(size_t count) { m_results.assign(count, XR_SUCCESS); }
+
+    // Record the result of locating space index this frame and log it, naming the space by description, if the space
+    // was not already failing with it. Pass XR_SUCCESS for a space whose failure is expected, such as an inactive hand.
+    void Record(size_t index, XrResult result, const char* description);
+
+   private:
+    std::vector<XrResult> m_results;
+};
+
+// Attach the GPU pass timings the graphics plugin has collected to the frames of timings that recorded the passes.
+void CollectGpuTimings(IGraphicsPlugin& graphicsPlugin, FrameTimingHistory& timings);
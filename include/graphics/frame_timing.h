@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Timings of one rendered frame. CPU times are known once the frame is submitted. GPU times arrive a few frames later,
+// when the timestamp queries of its passes have executed, and stay negative until then or if the device cannot time
+// passes.
+struct FrameTiming {
+    static constexpr size_t MaxViews = 2;
+
+    uint64_t frame{0};       // Frame index, counted from 1.
+    double waitMs{0};        // Blocked in xrWaitFrame, or pacing a frame without a display.
+    double beginMs{0};       // xrBeginFrame.
+    double renderCpuMs{0};   // Rendering the layer on the CPU: locating spaces, recording and submitting every view.
+    double endMs{0};         // xrEndFrame.
+    double displayPeriodMs{0};  // Predicted display period the frame had to fit in.
+    int64_t displayTime{0};     // Predicted display time [XrTime ns].
+    uint32_t missedPeriods{0};  // Display periods skipped since the previous frame; the frame was late if above 0.
+    std::array<double, MaxViews> viewGpuMs{{-1, -1}};  // Render pass per view. A multiview pass is reported for each view.
+
+    // CPU time of the frame between waits, the part that has to fit in a display period.
+    double cpuMs() const { return beginMs + renderCpuMs + endMs; }
+
+    bool late() const { return missedPeriods > 0; }
+
+    // Display periods between the previous display time and this one, less the one expected.
+    static uint32_t countMissedPeriods(int64_t previousDisplayTime, int64_t displayTime, int64_t displayPeriod) {
+        if (previousDisplayTime == 0 || displayPeriod <= 0 || displayTime <= previousDisplayTime) {
+            return 0;
+        }
+        // Rounded, as display times jitter by a fraction of a period.
+        const int64_t periods = (displayTime - previousDisplayTime + displayPeriod / 2) / displayPeriod;
+        return periods > 1 ? uint32_t(periods - 1) : 0;
+    }
+};
+
+// Running totals over every frame of a session, so what leaves the rolling window is still accounted for.
+struct SessionPacing {
+    uint64_t frames{0};
+    uint64_t lateFrames{0};
+    uint64_t missedPeriods{0};
+    uint64_t overruns{0};
+    double maxCpuMs{0};
+
+    void add(const FrameTiming& timing) {
+        frames++;
+        lateFrames += timing.late() ? 1 : 0;
+        missedPeriods += timing.missedPeriods;
+        overruns += timing.displayPeriodMs > 0 && timing.cpuMs() > timing.displayPeriodMs ? 1 : 0;
+        maxCpuMs = std::max(maxCpuMs, timing.cpuMs());
+    }
+};
+
+// Frame pacing over the frames held by a FrameTimingHistory, and over the whole session.
+struct FramePacingSummary {
+    size_t frames{0};
+    double meanWaitMs{0};
+    double meanCpuMs{0};
+    double p99CpuMs{0};
+    double maxCpuMs{0};
+    double meanDisplayPeriodMs{0};
+    size_t lateFrames{0};      // Frames displayed at least one period after the previous frame was due.
+    uint64_t missedPeriods{0};
+    size_t overruns{0};        // Frames whose CPU time exceeded their display period.
+    // GPU render pass per view, over the frames whose timings for that view have arrived.
+    std::array<size_t, FrameTiming::MaxViews> gpuFrames{};
+    std::array<double, FrameTiming::MaxViews> meanViewGpuMs{};
+    std::array<double, FrameTiming::MaxViews> p99ViewGpuMs{};
+    std::array<double, FrameTiming::MaxViews> maxViewGpuMs{};
+    SessionPacing session;
+
+    std::string describe() const {
+        char text[768];
+        int length = snprintf(text, sizeof(text),
+                              "%zu frames: wait %.2f ms, cpu mean %.2f p99 %.2f max %.2f ms, display period %.2f ms, "
+                              "%zu late (%llu periods missed), %zu overruns",
+                              frames, meanWaitMs, meanCpuMs, p99CpuMs, maxCpuMs, meanDisplayPeriodMs, lateFrames,
+                              (unsigned long long)missedPeriods, overruns);
+        for (size_t view = 0; view < FrameTiming::MaxViews && length > 0 && size_t(length) < sizeof(text); view++) {
+            if (gpuFrames[view] > 0) {
+                length += snprintf(text + length, sizeof(text) - length, ", view %zu gpu mean %.2f p99 %.2f max %.2f ms",
+                                   view, meanViewGpuMs[view], p99ViewGpuMs[view], maxViewGpuMs[view]);
+            }
+        }
+        if (length > 0 && size_t(length) < sizeof(text)) {
+            snprintf(text + length, sizeof(text) - length,
+                     "; whole session %llu frames: cpu max %.2f ms, %llu late (%llu periods missed), %llu overruns",
+                     (unsigned long long)session.frames, session.maxCpuMs, (unsigned long long)session.lateFrames,
+                     (unsigned long long)session.missedPeriods, (unsigned long long)session.overruns);
+        }
+        return text;
+    }
+};
+
+// Timings of the most recent frames in a fixed ring, so recording never allocates. Frames are numbered consecutively
+// by push. Not thread-safe: written and read by the frame loop.
+class FrameTimingHistory {
+   public:
+    static constexpr size_t Capacity = 512;
+
+    // Start the next frame, overwriting the oldest one once full. The previous frame is complete by now, apart from GPU
+    // times, and is added to the session totals.
+    FrameTiming& push() {
+        if (m_count > 0) {
+            m_session.add(m_frames[m_newest % Capacity]);
+        }
+        m_newest++;
+        m_count = m_count < Capacity ? m_count + 1 : Capacity;
+        FrameTiming& timing = m_frames[m_newest % Capacity];
+        timing = FrameTiming{};
+        timing.frame = m_newest;
+        return timing;
+    }
+
+    // The timing of frame, or nullptr once it has left the history.
+    FrameTiming* find(uint64_t frame) {
+        if (frame == 0 || frame > m_newest || m_newest - frame >= m_count) {
+            return nullptr;
+        }
+        return &m_frames[frame % Capacity];
+    }
+
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+
+    // Frame i of the history, 0 being the oldest held.
+    const FrameTiming& operator[](size_t i) const { return m_frames[(m_newest - m_count + 1 + i) % Capacity]; }
+
+    // Index of the newest frame, 0 before the first push.
+    uint64_t newest() const { return m_newest; }
+
+    // Totals over every frame pushed so far, the newest included.
+    SessionPacing session() const {
+        SessionPacing session = m_session;
+        if (m_count > 0) {
+            session.add(m_frames[m_newest % Capacity]);
+        }
+        return session;
+    }
+
+    // Pacing over every frame held, a rolling window of the last Capacity frames, with the session totals.
+    FramePacingSummary summarize() const {
+        FramePacingSummary summary;
+        summary.frames = m_count;
+        summary.session = session();
+        if (m_count == 0) {
+            return summary;
+        }
+        std::array<double, Capacity> cpuMs;
+        for (size_t i = 0; i < m_count; i++) {
+            const FrameTiming& timing = (*this)[i];
+            cpuMs[i] = timing.cpuMs();
+            summary.meanWaitMs += timing.waitMs;
+            summary.meanCpuMs += cpuMs[i];
+            summary.maxCpuMs = std::max(summary.maxCpuMs, cpuMs[i]);
+            summary.meanDisplayPeriodMs += timing.displayPeriodMs;
+            summary.lateFrames += timing.late() ? 1 : 0;
+            summary.missedPeriods += timing.missedPeriods;
+            summary.overruns += timing.displayPeriodMs > 0 && cpuMs[i] > timing.displayPeriodMs ? 1 : 0;
+        }
+        summary.meanWaitMs /= m_count;
+        summary.meanCpuMs /= m_count;
+        summary.meanDisplayPeriodMs /= m_count;
+        summary.p99CpuMs = percentile99(cpuMs, m_count);
+
+        // GPU times of the newest frames may still be in flight, those are left out.
+        std::array<double, Capacity>& gpuMs = cpuMs;
+        for (size_t view = 0; view < FrameTiming::MaxViews; view++) {
+            size_t count = 0;
+            for (size_t i = 0; i < m_count; i++) {
+                const double ms = (*this)[i].viewGpuMs[view];
+                if (ms >= 0) {
+                    gpuMs[count++] = ms;
+                    summary.meanViewGpuMs[view] += ms;
+                    summary.maxViewGpuMs[view] = std::max(summary.maxViewGpuMs[view], ms);
+                }
+            }
+            summary.gpuFrames[view] = count;
+            if (count > 0) {
+                summary.meanViewGpuMs[view] /= count;
+                summary.p99ViewGpuMs[view] = percentile99(gpuMs, count);
+            }
+        }
+        return summary;
+    }
+
+   private:
+    // 99th percentile of the first count values, which are reordered.
+    static double percentile99(std::array<double, Capacity>& values, size_t count) {
+        const auto p99 = values.begin() + (count - 1) * 99 / 100;
+        std::nth_element(values.begin(), p99, values.begin() + count);
+        return *p99;
+    }
+
+    std::array<FrameTiming, Capacity> m_frames{};
+    size_t m_count{0};
+    uint64_t m_newest{0};
+    SessionPacing m_session;  // Every frame before the newest.
+};
@@ -4,11 +4,27 @@
 
 #pragma once
 
+#include "frame_arena.h"
+
 struct Cube {
     XrPosef Pose;
     XrVector3f Scale;
 };
 
+// GPU execution time of one render pass, measured with timestamp queries.
+struct GpuPassTiming {
+    uint64_t frame;       // Frame index passed to BeginFrameTiming when the pass was recorded.
+    uint32_t viewMask;    // Views drawn by the pass, bit i for view i.
+    double durationMs;
+};
+
+// CPU cost of the most recent render pass.
+struct PassCpuTiming {
+    double waitMs;    // Waiting for the command buffer's previous submission to finish.
+    double recordMs;  // Recording the pass.
+    double submitMs;  // vkQueueSubmit and friends.
+};
+
 // Wraps a graphics API so the main openxr program can be graphics API-independent.
 struct IGraphicsPlugin {
     virtual ~IGraphicsPlugin() = default;
@@ -19,6 +35,9 @@ struct IGraphicsPlugin {
     // Create an instance of this graphics api for the provided instance and systemId.
     virtual void InitializeDevice(XrInstance instance, XrSystemId systemId) = 0;
 
+    // Create a device without an OpenXR runtime, for rendering into images from AllocateOffscreenImages.
+    virtual void InitializeHeadlessDevice() { throw std::logic_error("Headless rendering not supported by this graphics plugin"); }
+
     // Select the preferred swapchain format from the list of available formats.
     virtual int64_t SelectColorSwapchainFormat(const std::vector<int64_t>& runtimeFormats) const = 0;
 
@@ -30,9 +49,39 @@ struct IGraphicsPlugin {
     virtual std::vector<XrSwapchainImageBaseHeader*> AllocateSwapchainImageStructs(
         uint32_t capacity, const XrSwapchainCreateInfo& swapchainCreateInfo) = 0;
 
+    // Like AllocateSwapchainImageStructs, but also create the images themselves, sized and formatted as
+    // swapchainCreateInfo describes, so RenderView and RenderMultiview can draw without a swapchain.
+    virtual std::vector<XrSwapchainImageBaseHeader*> AllocateOffscreenImages(uint32_t /*capacity*/,
+                                                                            const XrSwapchainCreateInfo& /*swapchainCreateInfo*/) {
+        throw std::logic_error("Offscreen images not supported by this graphics plugin");
+    }
+
     // Render to a swapchain image for a projection view.
     virtual void RenderView(const XrCompositionLayerProjectionView& layerView, const XrSwapchainImageBaseHeader* swapchainImage,
-                            int64_t swapchainFormat, const std::vector<Cube>& cubes) = 0;
+                            int64_t swapchainFormat, const FrameArray<Cube>& cubes) = 0;
+
+    // True if RenderMultiview can draw every view of a frame in one pass into an array swapchain.
+    virtual bool SupportsMultiview() const { return false; }
+
+    // Render all projection views into the layers of one array swapchain image, view i into layer i.
+    virtual void RenderMultiview(const XrCompositionLayerProjectionView* /*layerViews*/, uint32_t /*viewCount*/,
+                                 const XrSwapchainImageBaseHeader* /*swapchainImage*/, int64_t /*swapchainFormat*/,
+                                 const FrameArray<Cube>& /*cubes*/) {
+        throw std::logic_error("Multiview rendering not supported by this graphics plugin");
+    }
+
+    // Tag the passes recorded from now on with frame, for matching their GPU timings to it later.
+    virtual void BeginFrameTiming(uint64_t /*frame*/) {}
+
+    // Move up to capacity GPU pass timings that have become available into timings, oldest first. Never waits for the
+    // GPU; results usually arrive a few frames after their passes were submitted. Returns the number written.
+    virtual size_t CollectGpuTimings(GpuPassTiming* /*timings*/, size_t /*capacity*/) { return 0; }
+
+    // CPU timing of the last RenderView or RenderMultiview call.
+    virtual PassCpuTiming GetLastPassCpuTiming() const { return {}; }
+
+    // Block until the GPU has finished all submitted work.
+    virtual void WaitIdle() {}
 
     // Get recommended number of sub-data element samples in view (recommendedSwapchainSampleCount)
     // if supported by the graphics plugin. A supported value otherwise.
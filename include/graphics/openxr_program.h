@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "frame_timing.h"
+
 // #define PI 3.14159265358979323846
 
 namespace Side {
@@ -12,6 +14,19 @@ const int RIGHT = 1;
 const int COUNT = 2;
 }  // namespace Side
 
+// Controller pose and velocity sampled by a single xrLocateSpace call.
+struct ControllerState {
+    XrSpaceLocation location;
+    XrSpaceVelocity velocity;
+};
+
+// Controller state published by the tracking thread.
+struct TrackedControllerState {
+    ControllerState state;
+    XrTime time;      // Time the controller was located at.
+    uint64_t sample;  // Number of samples published for this hand, 0 if none yet.
+};
+
 struct IOpenXrProgram {
     virtual ~IOpenXrProgram() = default;
 
@@ -41,11 +56,47 @@ struct IOpenXrProgram {
     // Sample input actions and generate haptic feedback.
     virtual void PollActions() = 0;
 
-    // Create and submit a frame.
+    // Create and submit a frame. Returns the predicted display time of the frame.
+    // In a headless session nothing is rendered: paces the caller at Options::HeadlessFrameRate and returns the current time.
     virtual XrTime RenderFrame() = 0;
 
+    // True if the session was created without graphics, see Options::Headless.
+    virtual bool isHeadless() const = 0;
+
     virtual XrSpaceLocation getControllerSpace(XrTime predictedDisplayTime, int hand) = 0;
+
+    // Locate a controller and return its pose together with the runtime-provided linear and angular velocity.
+    // Check the validity bits in locationFlags and velocityFlags before using the values.
+    virtual ControllerState getControllerState(XrTime predictedDisplayTime, int hand) = 0;
+
     virtual bool isHandActive(int hand) = 0;
+
+    // Start a thread that locates both controllers at the current time at rateHz, independent of RenderFrame.
+    // Without XR_KHR_convert_timespec_time, samples are only taken once a frame has anchored the current XrTime estimate.
+    virtual void startTracking(double rateHz) = 0;
+
+    // Stop the tracking thread. Called by the destructor if still running.
+    virtual void stopTracking() = 0;
+
+    // Latest controller state published by the tracking thread. Never blocks; safe to call from any thread.
+    virtual TrackedControllerState getTrackedControllerState(int hand) const = 0;
+
+    // Sleep until the tracking thread publishes a sample of hand newer than sample, or timeout passes, and return the latest
+    // state either way. Compare its sample with the one passed to tell them apart.
+    virtual TrackedControllerState waitTrackedControllerState(int hand, uint64_t sample, std::chrono::microseconds timeout) = 0;
+
+    // Convert an XrTime to steady clock seconds, the time base of the haptics code, and back.
+    // Both return 0 until the clock mapping is known.
+    virtual double toSteadyTime(XrTime time) const = 0;
+    virtual XrTime toXrTime(double steadyTime) const = 0;
+
+    // Pacing, CPU and per-view GPU render timings of recent frames. GPU times fill in a few frames after each frame.
+    virtual const FrameTimingHistory& getFrameTimings() const = 0;
+
+    // Wait and CPU times, late frames, CPU overruns of the display period and per-view GPU times over the frames held by
+    // getFrameTimings, with late frames, missed periods, overruns and maximum CPU time over the whole session. Also logged
+    // when the program is destroyed.
+    virtual FramePacingSummary getFramePacingSummary() const = 0;
 };
 
 struct Swapchain {
@@ -57,3 +108,9 @@ struct Swapchain {
 std::shared_ptr<IOpenXrProgram> CreateOpenXrProgram(const std::shared_ptr<Options>& options,
                                                     const std::shared_ptr<IPlatformPlugin>& platformPlugin,
                                                     const std::shared_ptr<IGraphicsPlugin>& graphicsPlugin);
+
+// Stand-in for the OpenXR program that needs no runtime or headset: replays the controller poses of Options::ReplayFile
+// with deterministic XrTime and runs the session until they end. Without a graphics plugin nothing is rendered; with one,
+// each frame draws the controllers offscreen on a device from InitializeHeadlessDevice.
+std::shared_ptr<IOpenXrProgram> CreateReplayProgram(const std::shared_ptr<Options>& options,
+                                                    const std::shared_ptr<IGraphicsPlugin>& graphicsPlugin = nullptr);
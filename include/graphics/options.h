@@ -4,6 +4,22 @@
 
 #pragma once
 
+#include <cstdlib>
+
+// Path of name in the per-user cache directory, $XDG_CACHE_HOME/vr_haptics or ~/.cache/vr_haptics. Empty when neither
+// variable is set, to write nothing rather than into the working directory.
+inline std::string UserCachePath(const std::string& name) {
+    const char* cacheHome = std::getenv("XDG_CACHE_HOME");
+    if (cacheHome != nullptr && cacheHome[0] == '/') {  // Relative values are invalid and ignored.
+        return std::string(cacheHome) + "/vr_haptics/" + name;
+    }
+    const char* home = std::getenv("HOME");
+    if (home != nullptr && home[0] != '\0') {
+        return std::string(home) + "/.cache/vr_haptics/" + name;
+    }
+    return "";
+}
+
 struct Options {
     std::string GraphicsPlugin;
 
@@ -14,4 +30,37 @@ struct Options {
     std::string EnvironmentBlendMode{"Opaque"};
 
     std::string AppSpace{"Local"};
+
+    // Command buffers the graphics plugin cycles through, one per view submission. Two per stereo frame lets the CPU
+    // record the next frame while the GPU executes the previous one; 1 keeps recording in lockstep with the GPU.
+    uint32_t CommandBufferCount{4};
+
+    // Render both eyes in a single pass into one array swapchain when the graphics plugin supports it.
+    bool Multiview{true};
+
+    // File the Vulkan pipeline cache is loaded from at startup and saved to at shutdown, its directory created if needed.
+    // Defaults to the per-user cache directory. Empty disables persistence.
+    std::string PipelineCachePath{UserCachePath("vulkan_pipeline_cache.bin")};
+
+    // Track controllers without rendering: create the session through XR_MND_headless, with no graphics device or
+    // swapchains. Falls back to rendering when the runtime lacks the extension or XR_KHR_convert_timespec_time.
+    bool Headless{false};
+
+    // Rate RenderFrame returns at in a headless session, which has no display to pace it.
+    double HeadlessFrameRate{500};
+
+    // Replace the OpenXR runtime with CreateReplayProgram, which replays controller poses.
+    bool Replay{false};
+
+    // Poses to replay, a csv file with a header row. Rows of "time, height" (as in data/11.16_pose_noise) move the right
+    // controller, held upright, vertically; rows of "time, hand, x, y, z, qx, qy, qz, qw" give full poses, hand 0 left and 1 right.
+    // Empty replays a scripted drumming trajectory of ReplayDuration seconds.
+    std::string ReplayFile;
+    double ReplayDuration{10};
+
+    // Display rate of a replay. XrTime advances by exactly one period per frame, so every run sees the same times.
+    double ReplayFrameRate{90};
+
+    // Hand out replayed frames in real time as a display would; off runs as fast as the caller loops.
+    bool ReplayRealTime{true};
 };
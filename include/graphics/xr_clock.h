@@ -0,0 +1,62 @@
+#pragma once
+
+#include "seqlock.hpp"
+
+// Converts between XrTime and the steady clock, the time base of the haptics code (CLOCK_MONOTONIC on Linux).
+//
+// With XR_KHR_convert_timespec_time the runtime is asked for the XrTime of a CLOCK_MONOTONIC reading every
+// recalibration interval, and consecutive readings fit the rate and offset of a linear mapping. Without it the mapping
+// is anchored on frame timing instead, assuming xrWaitFrame returns one display period before the predicted display time.
+//
+// Conversions only read the cached mapping, a multiply-add, and are safe from any thread. update is called from one
+// thread, the frame loop.
+class XrClock {
+   public:
+    // Load the conversion functions. extensionEnabled is whether XR_KHR_convert_timespec_time was enabled on the instance.
+    void initialize(XrInstance instance, bool extensionEnabled);
+
+    // Re-estimate the mapping once the recalibration interval has passed.
+    // waitFrameTime is the estimated XrTime xrWaitFrame returned at, used only without the extension.
+    void update(XrTime waitFrameTime);
+
+    // True once a mapping is available.
+    bool isCalibrated() const;
+
+    // True if the mapping comes from the runtime rather than frame timing.
+    bool usesRuntimeConversion() const { return m_convertToXrTime != nullptr; }
+
+    // Steady clock [s] to XrTime [ns].
+    XrTime toXrTime(double steadyTime) const;
+
+    // XrTime [ns] to steady clock [s].
+    double toSteadyTime(XrTime time) const;
+
+    // Current XrTime.
+    XrTime now() const;
+
+    // Current steady clock time [ns].
+    static int64_t steadyNowNs();
+
+   private:
+    // xr = xrRef + rate * (steady - steadyRef)
+    struct Mapping {
+        int64_t steadyRef;
+        XrTime xrRef;
+        double rate;
+        double inverseRate;
+    };
+
+    // Sample the runtime clock, returns false if the conversion failed.
+    bool calibrate();
+
+    // Publish a new reference point, refitting the rate against the previous one when it is far enough back.
+    void setReference(int64_t steadyNs, XrTime xrTime);
+
+    static constexpr int64_t kRecalibrationIntervalNs = 1000000000;
+
+    PFN_xrConvertTimespecTimeToTimeKHR m_convertToXrTime{nullptr};
+    XrInstance m_instance{XR_NULL_HANDLE};
+    int64_t m_lastCalibrationNs{0};
+    Mapping m_current{0, 0, 1.0, 1.0};  // Writer's copy of the published mapping.
+    Seqlock<Mapping> m_mapping;
+};
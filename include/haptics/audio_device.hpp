@@ -0,0 +1,51 @@
+#ifndef AUDIO_DEVICE_GUARD
+#define AUDIO_DEVICE_GUARD
+
+/// \file
+/// \brief Real-time playback of a SampleEngine through ALSA
+/// \details Built against ALSA when HAVE_ALSA is defined, otherwise start() always fails and
+/// the engine can only be rendered offline.
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <sample_engine.hpp>
+
+/// \brief audio thread that pulls blocks from a sample engine and writes them to a sound card
+class AudioDevice {
+
+    public:
+
+        /// \brief creates a stopped device
+        /// \param m_engine - engine to play, must outlive the device
+        /// \param m_name - ALSA device name
+        /// \param m_period - frames rendered per callback
+        AudioDevice(SampleEngine &m_engine, const std::string &m_name="default", int m_period=64);
+
+        /// \brief stops playback
+        ~AudioDevice();
+
+        AudioDevice(const AudioDevice&) = delete;
+        AudioDevice& operator=(const AudioDevice&) = delete;
+
+        /// \brief opens the sound card and starts the audio thread
+        /// \returns true if successful
+        bool start();
+
+        /// \brief stops the audio thread and closes the sound card
+        void stop();
+
+    private:
+
+        /// \brief audio thread loop
+        void run();
+
+        SampleEngine &engine;           //audio source
+        std::string name;               //ALSA device name
+        int period;                     //frames per callback
+        void *pcm;                      //ALSA handle
+        std::thread thread;             //audio thread
+        std::atomic<bool> running;      //audio thread should keep going
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef FORCE_LUT_GUARD
+#define FORCE_LUT_GUARD
+
+/// \file
+/// \brief Lookup table force models for nonlinear force-displacement curves
+
+#include <vector>
+#include <string>
+#include <functional>
+
+/// \brief interpolation used between table entries
+enum class Interpolation {
+    Linear,     //piecewise linear
+    Cubic       //Catmull-Rom spline through the entries
+};
+
+/// \brief force-displacement curve resampled onto a uniform grid
+/// \details the table is built once at load time so evaluation is an index computation and a few multiply-adds.
+/// Displacements outside the table are clamped to the first or last entry.
+class ForceLookupTable {
+
+    public:
+
+        /// \brief creates an empty table that always returns 0
+        ForceLookupTable();
+
+        /// \brief samples an analytic force law
+        /// \param f - force as a function of displacement
+        /// \param x_min - smallest tabulated displacement
+        /// \param x_max - largest tabulated displacement
+        /// \param n - number of table entries, at least 2
+        /// \param m_mode - interpolation between entries
+        ForceLookupTable(const std::function<double(double)> &f, double x_min, double x_max, int n, Interpolation m_mode);
+
+        /// \brief resamples measured (displacement, force) pairs
+        /// \param table - measured points, sorted by displacement
+        /// \param n - number of table entries, at least 2
+        /// \param m_mode - interpolation between entries
+        ForceLookupTable(const std::vector<std::pair<double,double>> &table, int n, Interpolation m_mode);
+
+        /// \brief computes force at a displacement
+        /// \param x - displacement
+        /// \returns interpolated force
+        double evaluate(double x) const;
+
+        /// \brief table size getter function
+        int size() const;
+
+    private:
+        std::vector<float> forces;  //force at each grid point
+        double x0;                  //displacement of first entry
+        double inv_dx;              //inverse grid spacing
+        Interpolation mode;         //interpolation method
+};
+
+/// \brief reads measured (displacement, force) pairs from a two column csv file with a header row
+/// \param filename - csv file
+/// \param table - parsed points sorted by displacement
+/// \returns true if at least two points were read
+bool loadForceTable(const std::string &filename, std::vector<std::pair<double,double>> &table);
+
+#endif
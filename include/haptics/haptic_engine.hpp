@@ -0,0 +1,151 @@
+#ifndef HAPTIC_ENGINE_GUARD
+#define HAPTIC_ENGINE_GUARD
+
+/// \file
+/// \brief One degree of freedom haptic rendering engine built from composable force primitives
+/// \details Primitives are plain structs held in a std::variant so a scene is evaluated with static dispatch.
+/// Positions and forces are in the units of the caller (m and N for the drum, degrees and Nm for the springs).
+/// A positive force pushes toward +x.
+
+#include <vector>
+#include <variant>
+#include <cmath>
+#include <algorithm>
+#include <float.h>
+#include <force_lut.hpp>
+
+/// \brief one sided spring, engaged when the position penetrates past the wall
+struct SpringWall {
+    double position = 0;        //wall location
+    double stiffness = 0;       //spring constant
+    int direction = 1;          //+1 if the wall is penetrated moving toward +x, -1 toward -x
+    bool quadratic = false;     //force grows with penetration squared instead of linearly
+    double range = DBL_MAX;     //penetration past which the wall disengages
+    double max_force = DBL_MAX; //force saturation
+
+    /// \returns restoring force pushing out of the wall
+    double force(double x, double /*v*/) const {
+        double penetration = direction*(x-position);
+        if (penetration <= 0 || penetration >= range) return 0;
+        double f = stiffness*(quadratic ? penetration*penetration : penetration);
+        return -direction*std::min(f,max_force);
+    }
+};
+
+/// \brief linear damper acting everywhere
+struct Damper {
+    double damping = 0;         //damping constant
+
+    /// \returns force opposing velocity
+    double force(double /*x*/, double v) const {
+        return -damping*v;
+    }
+};
+
+/// \brief single notch that pulls the position toward its center
+struct Detent {
+    double center = 0;          //notch center
+    double width = 1;           //half width of the notch
+    double strength = 0;        //peak force
+
+    /// \returns force toward the notch center
+    double force(double x, double /*v*/) const {
+        double offset = x-center;
+        if (std::abs(offset) >= width) return 0;
+        return -strength*std::sin(M_PI*offset/width);
+    }
+};
+
+/// \brief Coulomb friction, linear below a velocity threshold to avoid chatter at rest
+struct Friction {
+    double level = 0;                   //kinetic friction force
+    double velocity_threshold = 1e-3;   //velocity at which full friction is reached
+
+    /// \returns force opposing velocity
+    double force(double /*x*/, double v) const {
+        return -level*std::max(-1.0,std::min(v/velocity_threshold,1.0));
+    }
+};
+
+/// \brief periodic bumps that resist motion inside a region
+struct Texture {
+    double lower = -DBL_MAX;    //region start
+    double upper = DBL_MAX;     //region end
+    double period = 1;          //spatial period of the bumps
+    double amplitude = 0;       //peak force
+
+    /// \returns force opposing the direction of motion
+    double force(double x, double v) const {
+        if (x < lower || x > upper || v == 0) return 0;
+        double bump = 0.5*amplitude*(1+std::sin(2*M_PI*x/period));
+        return v > 0 ? -bump : bump;
+    }
+};
+
+/// \brief damper only engaged inside a region
+struct ViscousField {
+    double lower = -DBL_MAX;    //region start
+    double upper = DBL_MAX;     //region end
+    double damping = 0;         //damping constant
+
+    /// \returns force opposing velocity
+    double force(double x, double v) const {
+        if (x < lower || x > upper) return 0;
+        return -damping*v;
+    }
+};
+
+/// \brief one sided wall whose force-penetration law comes from a lookup table
+struct SurfaceCurve {
+    double position = 0;                        //wall location
+    int direction = 1;                          //+1 if the wall is penetrated moving toward +x, -1 toward -x
+    double range = DBL_MAX;                     //penetration past which the wall disengages
+    const ForceLookupTable *curve = nullptr;    //force magnitude versus penetration, owned by the caller
+
+    /// \returns restoring force pushing out of the wall
+    double force(double x, double /*v*/) const {
+        double penetration = direction*(x-position);
+        if (penetration <= 0 || penetration >= range || curve == nullptr) return 0;
+        return -direction*curve->evaluate(penetration);
+    }
+};
+
+/// \brief any haptic primitive
+using HapticPrimitive = std::variant<SpringWall,Damper,Detent,Friction,Texture,ViscousField,SurfaceCurve>;
+
+/// \brief collection of primitives whose forces are summed
+class HapticScene {
+
+    public:
+
+        /// \brief creates an empty, unsaturated scene
+        HapticScene();
+
+        /// \brief creates an empty scene
+        /// \param m_max_force - total force saturation
+        explicit HapticScene(double m_max_force);
+
+        /// \brief adds a primitive to the scene
+        void add(const HapticPrimitive &primitive);
+
+        /// \brief removes all primitives
+        void clear();
+
+        /// \brief computes the total force of all primitives
+        /// \param position - current position
+        /// \param velocity - current velocity
+        /// \returns saturated force
+        double evaluate(double position, double velocity) const;
+
+        /// \brief number of primitives getter function
+        int size() const;
+
+        /// \brief primitives getter function
+        std::vector<HapticPrimitive>& getPrimitives();
+
+    private:
+        std::vector<HapticPrimitive> primitives;    //scene contents
+        double max_force;                           //force saturation
+};
+
+#endif
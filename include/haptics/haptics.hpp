@@ -5,7 +5,11 @@
 /// \brief Library with various helper functions and objects used to create a haptic drumkit
 
 #include <vector>
+#include <string>
 #include <Eigen/Geometry>
+#include <haptic_engine.hpp>
+#include <hit_output.hpp>
+#include <predictive_trigger.hpp>
 
 namespace geometry {
 
@@ -48,6 +52,14 @@ namespace geometry {
     /// \param twist - twist to integrate
     /// \return transformation to new frame after twist
     double normalize_angle(double rad);
+
+    /// \brief computes the linear velocity of a point rigidly attached to a tracked body
+    /// \param Twb - body pose in world frame
+    /// \param body_linear_velocity - body linear velocity in world frame [m/s]
+    /// \param body_angular_velocity - body angular velocity in world frame [rad/s]
+    /// \param Tbp - point pose in body frame
+    /// \returns point linear velocity in world frame [m/s]
+    Eigen::Vector3f pointVelocity(const Eigen::Transform<float,3,Eigen::Affine> &Twb, const Eigen::Vector3f &body_linear_velocity, const Eigen::Vector3f &body_angular_velocity, const Eigen::Transform<float,3,Eigen::Affine> &Tbp);
 }
 
 /// \brief linearlly maps a value from an input range to an output range
@@ -57,6 +69,21 @@ namespace geometry {
 /// \returns mapped value
 double map(double val, std::pair<double,double> input_range, std::pair<double,double> output_range);
 
+/// \brief drumstick tip sample
+struct DrumstickState {
+    double time = 0;                                        //sample time on the steady clock [s]
+    Eigen::Vector3f position = Eigen::Vector3f::Zero();     //tip position [m]
+    Eigen::Vector3f velocity = Eigen::Vector3f::Zero();     //tip velocity [m/s]
+};
+
+/// \brief result of sweeping the drumstick tip between two samples
+struct DrumContact {
+    bool hit = false;                                       //true if the tip crossed down through the drum head
+    double time = 0;                                        //interpolated crossing time [s]
+    Eigen::Vector3f position = Eigen::Vector3f::Zero();     //crossing point [m]
+    Eigen::Vector3f velocity = Eigen::Vector3f::Zero();     //impact velocity [m/s]
+};
+
 /// \brief A haptic drum
 class Drum {
     
@@ -85,11 +112,31 @@ class Drum {
         /// \returns torque [Nm]
         double calculateTorque(const float &drumstick_z_position);
 
+        /// \brief replaces the quadratic spring with a tabulated force-displacement curve
+        /// \param curve - force [N] versus penetration [m], must outlive the drum, nullptr restores the spring
+        void setSurfaceCurve(const ForceLookupTable *curve);
+
+        /// \brief selects where hit messages are sent
+        /// \param m_output - hit destination, must outlive the drum, nullptr restores stdout
+        void setOutput(HitOutput *m_output);
+
+        /// \brief fires hits ahead of contact from the drumstick velocity instead of on the observed crossing
+        /// \details only used by the swept update, hits that do not land are cancelled
+        /// \param lookahead - how far ahead of contact hits are fired [s], should match the sound path latency
+        void enablePredictiveTrigger(double lookahead);
+
         /// \brief checks if drumstick just made initial contact
         /// \param drumstick_z_position - z coordinate of drumstick
         /// \returns true if drumstick just impacted drum
         bool checkContact(const float &drumstick_z_position);
 
+        /// \brief finds where the segment between two drumstick samples crosses down through the drum head
+        /// \details catches strikes that move through the head between tracking samples
+        /// \param previous - earlier drumstick sample
+        /// \param current - later drumstick sample
+        /// \returns crossing time, point and linearly interpolated velocity
+        DrumContact sweep(const DrumstickState &previous, const DrumstickState &current);
+
         /// \brief calculates the distance in the xy plane between the drumstick and the center of the drum
         /// \param drumstick_position - position of drumstick
         /// \returns distance
@@ -98,12 +145,19 @@ class Drum {
         /// \brief computes sustain and level commands then sends commands to PD
         /// \param drumstick_position - position of drumstick
         /// \param drumstick_velocity - drumstick velocity in the z direction
-        void sendToPureData(const Eigen::Vector3f &drumstick_position, const double &drumstick_velocity);
+        /// \param time - contact time on the steady clock [s], 0 to play as soon as possible
+        void sendToPureData(const Eigen::Vector3f &drumstick_position, const double &drumstick_velocity, double time=0);
 
         /// \brief performs all necessary computations and communicates with PD
         /// \returns torque [Nm]
         double update(const Eigen::Vector3f &drumstick_position, const double &drumstick_velocity);
 
+        /// \brief performs all necessary computations and communicates with PD using swept contact detection or the predictive trigger
+        /// \param previous - drumstick sample from the last update
+        /// \param current - newest drumstick sample
+        /// \returns torque [Nm]
+        double update(const DrumstickState &previous, const DrumstickState &current);
+
 
     private:
         Eigen::Vector3f center;                     //drum center [m]
@@ -113,6 +167,13 @@ class Drum {
         std::pair<double,double> sustain_limits;    //sustain range [%]
         std::pair<double,double> level_limits;      //level range
         int id;                                     //drum id
+        SpringWall surface;                         //quadratic spring under the drum head
+        SurfaceCurve surface_curve;                 //measured surface model, used when a curve is set
+        HitOutput *output = nullptr;                //hit destination, stdout when null
+        bool predictive = false;                    //fire hits from the predictive trigger
+        PredictiveTrigger trigger;                  //time-to-contact trigger for the drum head
+        bool hit_pending = false;                   //a predicted hit was sent and has not landed
+        HitEvent last_hit;                          //most recent hit sent
 };
 
 
@@ -148,4 +209,19 @@ class ExponentialFilter {
         bool initialized;               //true if initialized
 };
 
+/// \brief reads time and height columns from a logged csv file
+/// \details rows that do not parse or do not advance in time are skipped
+/// \param filename - csv file with a header row followed by "time, height" rows
+/// \param times - sample times [s]
+/// \param heights - sample heights [m]
+/// \returns true if at least three samples were read
+bool readHeightRecording(const std::string &filename, std::vector<double> &times, std::vector<double> &heights);
+
+/// \brief estimates velocity causally with a lowpass filtered backward difference, for recordings that only hold position
+/// \param times - sample times [s], strictly increasing
+/// \param positions - sample positions [m]
+/// \param alpha - ExponentialFilter constant, 1 disables filtering
+/// \returns velocity at each sample [m/s], 0 at the first
+std::vector<double> filteredVelocity(const std::vector<double> &times, const std::vector<double> &positions, double alpha);
+
 #endif
\ No newline at end of file
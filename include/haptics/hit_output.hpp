@@ -0,0 +1,108 @@
+#ifndef HIT_OUTPUT_GUARD
+#define HIT_OUTPUT_GUARD
+
+/// \file
+/// \brief Destinations for drum hit messages
+
+#include <string>
+
+/// \brief a single drum strike
+struct HitEvent {
+    int id = 0;                 //drum id
+    double level = 0;           //amplifier command
+    double sustain = 0;         //sustain command [%]
+    double time = 0;            //contact time on the steady clock [s], 0 to play as soon as possible
+    bool cancel = false;        //withdraws the earlier hit with the same id and time instead of playing
+};
+
+/// \returns current time on the steady clock [s], the time base of HitEvent::time
+double steadyTime();
+
+/// \brief interface for anything that consumes drum hits
+class HitOutput {
+
+    public:
+
+        virtual ~HitOutput() = default;
+
+        /// \brief delivers a hit, must not block the haptic loop
+        /// \param hit - hit to deliver
+        virtual void send(const HitEvent &hit) = 0;
+
+        /// \brief withdraws a predicted hit that has not started playing, outputs that play on arrival ignore it
+        /// \param hit - hit passed to send
+        virtual void cancel(const HitEvent &hit) {}
+};
+
+/// \brief writes FUDI messages to stdout so they can be piped into pdsend
+class StdoutOutput : public HitOutput {
+
+    public:
+
+        /// \brief writes "id level sustain;" and flushes
+        void send(const HitEvent &hit) override;
+};
+
+/// \brief socket transport used by FudiClient
+enum class FudiProtocol {
+    TCP,        //matches [netreceive port]
+    UDP         //matches [netreceive port 1]
+};
+
+/// \brief sends FUDI messages straight to a Pure Data netreceive object
+/// \details hit times are not sent, Pure Data plays each hit when it arrives. The socket is non-blocking and messages are formatted into a fixed buffer, so a send never waits on Pure Data.
+/// Messages that cannot be written immediately are dropped. A message TCP only partly accepts is finished before the next one, so Pure Data never sees a truncated message.
+/// If no connection can be made or it fails, hits go to stdout instead.
+class FudiClient : public HitOutput {
+
+    public:
+
+        /// \brief opens a socket to Pure Data
+        /// \param host - IPv4 address of the Pure Data host
+        /// \param port - netreceive port
+        /// \param m_protocol - TCP or UDP
+        FudiClient(const std::string &host, int port, FudiProtocol m_protocol);
+
+        /// \brief closes the socket
+        ~FudiClient();
+
+        FudiClient(const FudiClient&) = delete;
+        FudiClient& operator=(const FudiClient&) = delete;
+
+        /// \brief formats and sends "id level sustain;"
+        void send(const HitEvent &hit) override;
+
+        /// \returns true if messages are going to Pure Data rather than stdout
+        bool isConnected();
+
+        /// \brief dropped message count getter function
+        int getDroppedCount();
+
+    private:
+
+        /// \brief finishes a non-blocking TCP connect
+        /// \returns true once the socket is writable
+        bool pollConnection();
+
+        /// \brief closes the socket and switches to stdout
+        void fallback();
+
+        /// \brief writes as much of the unsent tail of a message as the socket takes
+        /// \returns true once nothing is left unsent, false if the socket is full or failed
+        bool flushPending();
+
+        /// \brief checks whether a failed write means the connection is gone, switching to stdout if so
+        /// \returns true if the socket was only full
+        bool writeWouldBlock();
+
+        int fd;                     //socket file descriptor, -1 after falling back to stdout
+        FudiProtocol protocol;      //socket transport
+        bool connected;             //connect has completed
+        int dropped;                //messages dropped because the socket was full
+        char buffer[64];            //preformatted message
+        char pending[64];           //tail of a message TCP only partly accepted
+        int pending_length;         //bytes left in pending
+        StdoutOutput stdout_output; //fallback output
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef LATENCY_PROBE_GUARD
+#define LATENCY_PROBE_GUARD
+
+/// \file
+/// \brief Per-stage latency instrumentation for the haptic loop
+/// \details Every stage is stamped on the steady clock, the time base of HitEvent::time and DrumstickState::time.
+/// Each stage keeps two histograms: the time since the previous stamped stage of the same sample and the time since the
+/// pose the sample was computed from. With predicted poses the pose time is in the future, so end-to-end latency can be negative.
+
+#include <array>
+#include <vector>
+#include <ostream>
+#include <hit_output.hpp>
+
+/// \brief stages of the haptic loop, in pipeline order
+enum class LatencyStage {
+    Pose,       //pose received by the loop
+    Filter,     //filtered drumstick position ready
+    Update,     //drum updates finished
+    Torque,     //torque command written to the motor controller
+    Hit         //hit message handed to the sound output, measured from the filter stage since it happens during the update
+};
+
+/// \brief collects stage stamps into fixed latency histograms
+/// \details histograms are allocated at construction, so stamping never allocates
+class LatencyProbe {
+
+    public:
+
+        static constexpr int stage_count = 5;   //number of stages
+
+        /// \brief creates a probe covering -50 ms to 200 ms in 0.01 ms bins
+        LatencyProbe();
+
+        /// \brief creates a probe
+        /// \param m_min_ms - smallest latency recorded, lower values are clamped [ms]
+        /// \param m_max_ms - largest latency recorded, higher values are clamped [ms]
+        /// \param m_bin_ms - histogram resolution [ms]
+        LatencyProbe(double m_min_ms, double m_max_ms, double m_bin_ms);
+
+        /// \brief starts a sample and stamps the pose stage now
+        /// \param pose_time - steady clock time the pose describes [s]
+        void beginSample(double pose_time);
+
+        /// \brief stamps a stage of the current sample now
+        void stamp(LatencyStage stage);
+
+        /// \brief stamps a stage of the current sample
+        /// \param stage - stage reached
+        /// \param time - steady clock time the stage was reached [s]
+        void stamp(LatencyStage stage, double time);
+
+        /// \brief latency percentile of a stage
+        /// \param stage - stage
+        /// \param percentile - percentile in [0,100]
+        /// \param end_to_end - measure from the pose time instead of the previous stage
+        /// \returns latency [ms], 0 if the stage was never stamped
+        double getPercentile(LatencyStage stage, double percentile, bool end_to_end) const;
+
+        /// \brief number of stamps of a stage
+        int getSampleCount(LatencyStage stage) const;
+
+        /// \brief writes per-stage and end-to-end latency statistics as csv
+        /// \param out - stream to write to
+        void report(std::ostream &out) const;
+
+        /// \brief clears all histograms
+        void reset();
+
+    private:
+
+        /// \brief fixed bin latency histogram
+        struct Histogram {
+            std::vector<int> bins;      //counts per bin
+            int count = 0;              //number of values
+            double sum = 0;             //sum of values [ms]
+            double max = 0;             //largest value [ms]
+        };
+
+        /// \brief adds a value to a histogram
+        void add(Histogram &histogram, double ms);
+
+        /// \brief percentile of a histogram
+        double percentile(const Histogram &histogram, double p) const;
+
+        double min_ms;                                  //lowest bin edge [ms]
+        double bin_ms;                                  //bin width [ms]
+        int bin_count;                                  //number of bins
+        double pose_time;                               //pose time of the current sample [s]
+        double last_time;                               //last stamp of the current sample [s]
+        std::array<Histogram,stage_count> stage;        //time since the previous stage
+        std::array<Histogram,stage_count> end_to_end;   //time since the pose
+};
+
+/// \brief stage names used in reports
+const char* toString(LatencyStage stage);
+
+/// \brief forwards hits to another output and stamps the hit stage once each is handed over
+class ProbedOutput : public HitOutput {
+
+    public:
+
+        /// \brief wraps an output
+        /// \param m_output - output hits are forwarded to, must outlive this object
+        /// \param m_probe - probe to stamp, must outlive this object
+        ProbedOutput(HitOutput &m_output, LatencyProbe &m_probe);
+
+        /// \brief forwards the hit then stamps LatencyStage::Hit
+        void send(const HitEvent &hit) override;
+
+        /// \brief forwards the cancel
+        void cancel(const HitEvent &hit) override;
+
+    private:
+        HitOutput &output;      //wrapped output
+        LatencyProbe &probe;    //probe to stamp
+};
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef OSC_OUTPUT_GUARD
+#define OSC_OUTPUT_GUARD
+
+/// \file
+/// \brief Open Sound Control output over UDP for hits and per-frame telemetry
+/// \details Messages, all float arguments are 32 bit:
+/// - /drum/hit i f f - drum id, level, sustain, in a bundle timetagged with the contact time
+/// - /drum/cancel i - drum id of a predicted hit that did not land, timetagged with its contact time
+/// - /stick/position f f f - drumstick tip position [m]
+/// - /stick/velocity f f f - drumstick tip velocity [m/s]
+/// - /haptics/torque f - motor torque command [Nm]
+///
+/// Telemetry for a frame is collected into one bundle so the receiver gets a single packet per frame.
+
+#include <string>
+#include <cstdint>
+#include <hit_output.hpp>
+
+/// \brief sends OSC bundles to a UDP port
+/// \details packets are encoded into fixed buffers owned by the object, so sending never allocates
+class OscOutput : public HitOutput {
+
+    public:
+
+        /// \brief opens a non-blocking UDP socket
+        /// \param host - IPv4 address of the receiver
+        /// \param port - receiver port
+        OscOutput(const std::string &host, int port);
+
+        /// \brief closes the socket
+        ~OscOutput();
+
+        OscOutput(const OscOutput&) = delete;
+        OscOutput& operator=(const OscOutput&) = delete;
+
+        /// \brief sends /drum/hit in a bundle timetagged with the hit time
+        void send(const HitEvent &hit) override;
+
+        /// \brief sends /drum/cancel in a bundle timetagged with the hit time
+        void cancel(const HitEvent &hit) override;
+
+        /// \brief starts a telemetry bundle, discarding one that was not sent
+        /// \param time - steady clock time the values refer to [s], 0 for immediately
+        void beginFrame(double time);
+
+        /// \brief adds /stick/position and /stick/velocity to the telemetry bundle
+        /// \param position - tip position [m]
+        /// \param velocity - tip velocity [m/s]
+        void addStick(const float position[3], const float velocity[3]);
+
+        /// \brief adds /haptics/torque to the telemetry bundle
+        /// \param torque - torque command [Nm]
+        void addTorque(double torque);
+
+        /// \brief sends the telemetry bundle
+        void sendFrame();
+
+        /// \returns true if the socket is open
+        bool isOpen();
+
+        /// \brief number of packets the socket would not accept
+        int getDroppedCount();
+
+    private:
+
+        /// \brief fixed size packet under construction
+        struct Packet {
+            char data[512];             //encoded bytes
+            int size = 0;               //bytes used
+            bool overflow = false;      //a write did not fit
+        };
+
+        /// \brief writes the bundle header
+        void beginBundle(Packet &packet, double time);
+
+        /// \brief writes a bundle element size placeholder and the message address and type tags
+        /// \returns offset of the size placeholder
+        int beginMessage(Packet &packet, const char *address, const char *types);
+
+        /// \brief fills in a bundle element size once its arguments are written
+        void endMessage(Packet &packet, int size_offset);
+
+        /// \brief appends a big endian 32 bit integer
+        void writeInt(Packet &packet, int32_t value);
+
+        /// \brief appends a big endian 32 bit float
+        void writeFloat(Packet &packet, float value);
+
+        /// \brief appends a null terminated string padded to 4 bytes
+        void writeString(Packet &packet, const char *value);
+
+        /// \brief converts a steady clock time to an NTP timetag
+        uint64_t toTimetag(double time);
+
+        /// \brief sends a finished packet
+        void transmit(Packet &packet);
+
+        int fd;                     //socket file descriptor, -1 if the socket could not be opened
+        double ntp_offset;          //NTP time minus steady clock time [s]
+        int dropped;                //packets the socket would not accept
+        Packet hit_packet;          //buffer for hit and cancel bundles
+        Packet frame_packet;        //buffer for the telemetry bundle
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef POSE_PREDICTION_GUARD
+#define POSE_PREDICTION_GUARD
+
+/// \file
+/// \brief Interpolates and extrapolates tracked poses so a fast haptic loop can run between tracking updates
+
+#include <array>
+#include <Eigen/Geometry>
+
+/// \brief timestamped pose and velocity of a tracked point
+struct PoseSample {
+    double time = 0;                                                //sample time [s]
+    Eigen::Vector3f position = Eigen::Vector3f::Zero();             //position [m]
+    Eigen::Quaternionf orientation = Eigen::Quaternionf::Identity();//orientation
+    Eigen::Vector3f linear_velocity = Eigen::Vector3f::Zero();      //linear velocity [m/s]
+    Eigen::Vector3f angular_velocity = Eigen::Vector3f::Zero();     //angular velocity in world frame [rad/s]
+};
+
+/// \brief predicts the pose of a tracked point at arbitrary query times
+/// \details samples are kept in a fixed size ring buffer so no memory is allocated after construction.
+/// Queries inside the buffered history are interpolated with a cubic Hermite spline that uses the sampled velocities.
+/// Queries past the newest sample are extrapolated at constant velocity for at most max_horizon seconds.
+class PosePredictor {
+
+    public:
+
+        /// \brief number of samples kept in history
+        static constexpr int capacity = 8;
+
+        /// \brief creates a predictor with a 20 ms extrapolation horizon
+        PosePredictor();
+
+        /// \brief creates a predictor
+        /// \param m_max_horizon - maximum extrapolation past the newest sample [s]
+        explicit PosePredictor(double m_max_horizon);
+
+        /// \brief adds a tracked sample, samples that are not newer than the last one are ignored
+        /// \param sample - tracked pose and velocity
+        void addSample(const PoseSample &sample);
+
+        /// \brief predicts pose and velocity at a query time
+        /// \param time - query time [s]
+        /// \param prediction - predicted pose and velocity
+        /// \returns false if no samples have been added
+        bool predict(double time, PoseSample &prediction) const;
+
+        /// \brief removes all samples
+        void reset();
+
+        /// \brief newest sample getter function
+        const PoseSample& getLatestSample() const;
+
+        /// \brief number of buffered samples getter function
+        int getSampleCount() const;
+
+        /// \brief maximum extrapolation horizon getter function
+        double getMaxHorizon() const;
+
+    private:
+
+        /// \brief sample getter where 0 is the oldest buffered sample
+        const PoseSample& at(int i) const;
+
+        std::array<PoseSample,capacity> samples;    //ring buffer of samples
+        int head;                                   //index of newest sample
+        int count;                                  //number of buffered samples
+        double max_horizon;                         //extrapolation limit [s]
+};
+
+#endif
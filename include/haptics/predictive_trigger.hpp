@@ -0,0 +1,75 @@
+#ifndef PREDICTIVE_TRIGGER_GUARD
+#define PREDICTIVE_TRIGGER_GUARD
+
+/// \file
+/// \brief Fires drum hits before contact by forecasting when the stick tip reaches the drum plane
+
+/// \brief what the trigger decided for a sample
+enum class TriggerAction {
+    None,       //nothing to do
+    Fire,       //emit a hit for the forecast contact time
+    Cancel,     //the stick stopped short, withdraw the last hit
+    Confirm     //the stick reached the plane after a hit was fired
+};
+
+/// \brief trigger decision for a sample
+struct TriggerResult {
+    TriggerAction action = TriggerAction::None;     //decision
+    double contact_time = 0;                        //forecast or interpolated time the tip reaches the plane [s]
+    double velocity = 0;                            //velocity at contact [m/s]
+};
+
+/// \brief time-to-contact trigger for one drum plane
+/// \details a hit is fired once the tip is moving down and its constant velocity forecast reaches the plane within the lookahead,
+/// which should be set to the measured latency of the sound path. A fired hit is cancelled if the tip stops or turns around above
+/// the plane, or is still above it a full lookahead after the forecast contact. Crossings that were not forecast fire late with
+/// the interpolated crossing time. The trigger rearms once the tip rises back above the plane.
+class PredictiveTrigger {
+
+    public:
+
+        /// \brief creates a trigger with a 20 ms lookahead and a 0.2 m/s minimum strike speed
+        PredictiveTrigger();
+
+        /// \brief creates a trigger
+        /// \param m_lookahead - how far ahead of contact hits are fired [s]
+        /// \param m_min_speed - slowest downward speed treated as a strike [m/s]
+        PredictiveTrigger(double m_lookahead, double m_min_speed);
+
+        /// \brief advances the trigger by one sample
+        /// \param time - sample time [s]
+        /// \param height - tip height above the drum plane [m]
+        /// \param velocity - tip vertical velocity [m/s]
+        /// \returns decision for this sample
+        TriggerResult update(double time, double height, double velocity);
+
+        /// \brief returns to the armed state and forgets the last sample
+        void reset();
+
+        /// \brief lookahead setter function
+        void setLookahead(double m_lookahead);
+
+        /// \brief lookahead getter function
+        double getLookahead() const;
+
+    private:
+
+        /// \brief trigger state
+        enum class State {
+            Armed,      //waiting for a strike
+            Fired,      //hit emitted, contact not yet seen
+            Contact     //tip below the plane
+        };
+
+        State state;                //trigger state
+        double lookahead;           //fire this far ahead of contact [s]
+        double min_speed;           //slowest strike [m/s]
+        double rearm_height;        //height above the plane needed to rearm [m]
+        double fired_time;          //forecast contact time of the fired hit [s]
+        bool has_last;              //a previous sample exists
+        double last_time;           //previous sample time [s]
+        double last_height;         //previous sample height [m]
+        double last_velocity;       //previous sample velocity [m/s]
+};
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef SAMPLE_ENGINE_GUARD
+#define SAMPLE_ENGINE_GUARD
+
+/// \file
+/// \brief In-process drum sampler, a C++ replacement for drum/drum_kit.pd
+/// \details Hits are pushed from the haptic loop through a lock-free queue and mixed in the audio callback.
+/// Nothing on the audio side locks or allocates once the samples are loaded.
+
+#include <vector>
+#include <array>
+#include <string>
+#include <atomic>
+#include <hit_output.hpp>
+#include <spsc_queue.hpp>
+
+/// \brief mono audio clip
+struct Sample {
+    std::vector<float> data;    //samples in [-1,1]
+    int sample_rate = 0;        //sample rate [Hz]
+};
+
+/// \brief reads a PCM or float wav file, mixing down to mono
+/// \param filename - wav file
+/// \param sample - decoded audio
+/// \returns true if successful
+bool loadWav(const std::string &filename, Sample &sample);
+
+/// \brief writes interleaved audio as a 16 bit PCM wav file
+/// \param filename - wav file
+/// \param data - interleaved samples in [-1,1]
+/// \param channels - number of channels
+/// \param sample_rate - sample rate [Hz]
+/// \returns true if successful
+bool saveWav(const std::string &filename, const std::vector<float> &data, int channels, int sample_rate);
+
+/// \brief linearly resamples a clip
+/// \param sample - clip to convert in place
+/// \param sample_rate - new sample rate [Hz]
+void resample(Sample &sample, int sample_rate);
+
+/// \brief envelope times, defaults match [adsr 1 10 70 300] in the Pure Data sampler
+/// \details the hit level is the attack peak and the hit sustain is a percentage of it, as in adsr.pd
+struct AdsrEnvelope {
+    double attack = 1;          //time to reach the hit level [ms]
+    double decay = 10;          //time to fall to the sustain level [ms]
+    double release = 300;       //time to fade out once a voice is released [ms]
+};
+
+/// \brief drum sampler that plays hits through an ADSR envelope
+/// \details timestamped hits start a fixed latency after their contact time rather than when they are dequeued,
+/// so onsets do not jitter with the frame loop or the audio block size. Hits that arrive too late start at once.
+class SampleEngine : public HitOutput {
+
+    public:
+
+        static constexpr int max_voices = 16;       //simultaneous hits
+        static constexpr int channels = 2;          //interleaved output channels
+
+        /// \brief creates a 48 kHz engine with no samples
+        SampleEngine();
+
+        /// \brief creates an engine with no samples
+        /// \param m_sample_rate - output sample rate [Hz]
+        explicit SampleEngine(int m_sample_rate);
+
+        /// \brief loads a wav file for a drum, not real-time safe
+        /// \param id - drum id the sample plays for
+        /// \param filename - wav file
+        /// \returns true if successful
+        bool loadSample(int id, const std::string &filename);
+
+        /// \brief loads kick.wav, snare.wav and hi_hat.wav for the drumkit ids
+        /// \param directory - folder containing the samples
+        /// \returns true if all samples loaded
+        bool loadDrumKit(const std::string &directory);
+
+        /// \brief sets envelope times used by new hits
+        void setEnvelope(const AdsrEnvelope &m_envelope);
+
+        /// \brief sets the delay from contact time to sample onset
+        /// \param m_latency - delay [s], should cover the haptic loop, queue and audio buffer delays
+        void setLatency(double m_latency);
+
+        /// \brief queues a hit, called from the haptic loop
+        void send(const HitEvent &hit) override;
+
+        /// \brief withdraws a queued hit that has not started, called from the haptic loop
+        void cancel(const HitEvent &hit) override;
+
+        /// \brief mixes the next block of audio on the engine's clock, called from the audio thread
+        /// \details the steady clock is sampled every call and smoothed against the frame count to time the block
+        /// \param out - interleaved output, channels*frames floats
+        /// \param frames - number of frames to render
+        void render(float *out, int frames);
+
+        /// \brief mixes the next block of audio
+        /// \param out - interleaved output, channels*frames floats
+        /// \param frames - number of frames to render
+        /// \param time - steady clock time at which the first frame is played [s]
+        void render(float *out, int frames, double time);
+
+        /// \brief sample rate getter function
+        int getSampleRate() const;
+
+        /// \brief number of voices currently sounding, audio thread only
+        int getActiveVoiceCount() const;
+
+        /// \brief number of hits lost because the queue was full
+        int getDroppedCount() const;
+
+        /// \brief number of hits that started after their scheduled time, audio thread only
+        int getLateCount() const;
+
+        /// \brief number of hits withdrawn before they started, audio thread only
+        int getCancelledCount() const;
+
+    private:
+
+        /// \brief envelope stage of a voice
+        enum class Stage {
+            Idle,
+            Attack,
+            Decay,
+            Sustain,
+            Release
+        };
+
+        /// \brief one playing sample
+        struct Voice {
+            const Sample *sample = nullptr;     //clip being played
+            int id = -1;                        //drum id
+            std::size_t position = 0;           //next sample index
+            Stage stage = Stage::Idle;          //envelope stage
+            double gain = 0;                    //current envelope value
+            double step = 0;                    //envelope change per sample in the current stage
+            double peak = 0;                    //attack target
+            double sustain = 0;                 //decay target
+            long age = 0;                       //start order, used to steal the oldest voice
+        };
+
+        /// \brief starts a voice for a hit and releases earlier voices of the same drum
+        void startVoice(const HitEvent &hit);
+
+        /// \brief moves a voice into a stage, setting the per-sample ramp
+        void enterStage(Voice &voice, Stage stage);
+
+        /// \brief adds all sounding voices into part of a block
+        /// \param out - interleaved output at the first frame to mix
+        /// \param frames - number of frames to mix
+        void mix(float *out, int frames);
+
+        int sample_rate;                        //output sample rate [Hz]
+        AdsrEnvelope envelope;                  //envelope times
+        std::vector<Sample> samples;            //clips indexed by drum id
+        std::array<Voice,max_voices> voices;    //voice pool
+        long voice_count;                       //voices started so far
+        SpscQueue<HitEvent,64> queue;           //hits waiting for the audio thread
+        std::array<HitEvent,64> pending;        //dequeued hits waiting for their start time
+        int pending_count;                      //number of pending hits
+        double latency;                         //contact to onset delay [s]
+        double clock_base;                      //smoothed steady clock time of frame 0 [s]
+        long frame_count;                       //frames rendered on the engine's clock
+        int late;                               //hits started after their scheduled time
+        int cancelled;                          //hits withdrawn before they started
+        std::atomic<int> dropped;               //hits lost to a full queue
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef SAMPLE_SIGNAL_GUARD
+#define SAMPLE_SIGNAL_GUARD
+
+/// \file
+/// \brief Wakes threads waiting for a producer to publish a new sample
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+/// \brief lets consumers sleep until a producer publishes, instead of polling
+/// \details the published value itself lives elsewhere (e.g. a Seqlock), the mutex only orders the wake up against the
+/// consumer's check so a notification between the check and the sleep is not lost
+class SampleSignal {
+
+    public:
+
+        /// \brief wakes every waiter, call after publishing
+        void notify() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+            }
+            condition.notify_all();
+        }
+
+        /// \brief sleeps until ready returns true or timeout passes
+        /// \param timeout - longest wait
+        /// \param ready - checks for the awaited sample, called with the lock held
+        /// \returns ready() after waking
+        template <typename Predicate>
+        bool wait(std::chrono::microseconds timeout, Predicate ready) {
+            std::unique_lock<std::mutex> lock(mutex);
+            return condition.wait_for(lock,timeout,ready);
+        }
+
+    private:
+        std::mutex mutex;                       //orders notify against waiters' checks
+        std::condition_variable condition;      //waiters sleep here
+};
+
+#endif
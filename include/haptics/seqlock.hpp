@@ -0,0 +1,67 @@
+#ifndef SEQLOCK_GUARD
+#define SEQLOCK_GUARD
+
+/// \file
+/// \brief Lock-free single writer, many reader snapshot of a value
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/// \brief publishes the latest value of a trivially copyable type from one writer thread to any number of readers
+/// \details the writer never waits, readers retry while a write is in progress. The value is copied through relaxed atomic
+/// words so a torn read is detected by the sequence counter instead of being a data race.
+/// \tparam T - value type, trivially copyable
+template <typename T>
+class Seqlock {
+
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock value must be trivially copyable");
+
+    public:
+
+        /// \brief publishes a value, writer only
+        /// \param value - value to publish
+        void store(const T &value) {
+            std::array<uint64_t,word_count> words{};
+            std::memcpy(words.data(),&value,sizeof(T));
+
+            uint64_t s = sequence.load(std::memory_order_relaxed);
+            sequence.store(s+1,std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (std::size_t i=0; i<word_count; i++) data[i].store(words[i],std::memory_order_relaxed);
+            sequence.store(s+2,std::memory_order_release);
+        }
+
+        /// \brief reads the latest value
+        /// \param value - latest value, left unchanged if nothing has been published
+        /// \returns number of values published so far, 0 if none
+        uint64_t load(T &value) const {
+            std::array<uint64_t,word_count> words;
+            uint64_t before, after;
+            do {
+                before = sequence.load(std::memory_order_acquire);
+                for (std::size_t i=0; i<word_count; i++) words[i] = data[i].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                after = sequence.load(std::memory_order_relaxed);
+            } while ((before & 1) || before != after);
+
+            if (before == 0) return 0;
+            std::memcpy(&value,words.data(),sizeof(T));
+            return before/2;
+        }
+
+        /// \returns number of values published so far
+        uint64_t getVersion() const {
+            return sequence.load(std::memory_order_acquire)/2;
+        }
+
+    private:
+        static constexpr std::size_t word_count = (sizeof(T)+7)/8;     //value size in 64 bit words
+
+        std::array<std::atomic<uint64_t>,word_count> data{};            //value copy
+        alignas(64) std::atomic<uint64_t> sequence{0};                  //odd while a write is in progress
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef SPSC_QUEUE_GUARD
+#define SPSC_QUEUE_GUARD
+
+/// \file
+/// \brief Lock-free single producer, single consumer queue
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/// \brief fixed capacity ring buffer safe for one producer thread and one consumer thread
+/// \details neither side locks or allocates, so it can sit between the haptic loop and a real-time audio callback
+/// \tparam T - element type
+/// \tparam N - capacity, a power of two
+template <typename T, std::size_t N>
+class SpscQueue {
+
+    static_assert(N >= 2 && (N & (N-1)) == 0, "SpscQueue capacity must be a power of two");
+
+    public:
+
+        /// \brief adds an element, producer only
+        /// \param item - element to add
+        /// \returns false if the queue is full
+        bool push(const T &item) {
+            std::size_t t = tail.load(std::memory_order_relaxed);
+            if (t-head.load(std::memory_order_acquire) == N) return false;
+            buffer[t & (N-1)] = item;
+            tail.store(t+1,std::memory_order_release);
+            return true;
+        }
+
+        /// \brief removes the oldest element, consumer only
+        /// \param item - removed element
+        /// \returns false if the queue is empty
+        bool pop(T &item) {
+            std::size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire)) return false;
+            item = buffer[h & (N-1)];
+            head.store(h+1,std::memory_order_release);
+            return true;
+        }
+
+        /// \brief reads the oldest element without removing it, consumer only
+        /// \param item - oldest element
+        /// \returns false if the queue is empty
+        bool peek(T &item) const {
+            std::size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire)) return false;
+            item = buffer[h & (N-1)];
+            return true;
+        }
+
+        /// \returns true if there is nothing to pop
+        bool empty() const {
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+
+    private:
+        std::array<T,N> buffer;                         //elements
+        alignas(64) std::atomic<std::size_t> head{0};   //next element to pop
+        alignas(64) std::atomic<std::size_t> tail{0};   //next slot to push
+};
+
+#endif
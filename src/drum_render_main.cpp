@@ -0,0 +1,110 @@
+#include <sample_engine.hpp>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <string>
+
+/// \brief hit at a time in the rendered clip
+struct TimedHit {
+    double time;        //hit time [s]
+    HitEvent hit;       //hit
+};
+
+/// \brief reads hits from a csv file with time, id, level and sustain columns and a header row
+/// \param filename - csv file
+/// \param hits - parsed hits sorted by time
+/// \returns true if any hits were read
+bool loadHits(const std::string &filename, std::vector<TimedHit> &hits) {
+    std::ifstream datafile(filename);
+    if (!datafile.is_open()) return false;
+
+    std::string line;
+    std::getline(datafile,line);
+    while (std::getline(datafile,line)) {
+        std::stringstream row(line);
+        std::string time, id, level, sustain;
+        if (!std::getline(row,time,',') || !std::getline(row,id,',') || !std::getline(row,level,',') || !std::getline(row,sustain,',')) continue;
+        try {
+            TimedHit h;
+            h.time = std::stod(time);
+            h.hit.id = std::stoi(id);
+            h.hit.level = std::stod(level);
+            h.hit.sustain = std::stod(sustain);
+            hits.push_back(h);
+        }
+        catch (const std::exception&) {
+            continue;
+        }
+    }
+    std::sort(hits.begin(),hits.end(),[](const TimedHit &a, const TimedHit &b) { return a.time < b.time; });
+    return !hits.empty();
+}
+
+/// \brief one bar of a basic rock beat
+std::vector<TimedHit> demoPattern() {
+    std::vector<TimedHit> hits;
+    for (int i=0; i<8; i++) {
+        double t = 0.25*i;
+        hits.push_back({t,{2,0.3,100}});
+        if (i%4 == 0) hits.push_back({t,{1,0.6,100}});
+        if (i%4 == 2) hits.push_back({t,{0,0.5,100}});
+    }
+    return hits;
+}
+
+int main(int argc, char* argv[]) {
+
+    int period = 64;                //frames per render block, as in the real-time device
+    double tail = 1;                //audio rendered after the last hit [s]
+
+    std::string sample_directory;
+    std::string output_file;
+    std::vector<TimedHit> hits;
+
+    //Parse command line arguements
+    if (argc == 3) {
+        sample_directory = argv[1];
+        output_file = argv[2];
+        hits = demoPattern();
+    }
+    else if (argc == 4) {
+        sample_directory = argv[1];
+        output_file = argv[2];
+        if (!loadHits(argv[3],hits)) {
+            std::cout << "Could not read hits from " << argv[3] << std::endl;
+            return 1;
+        }
+    }
+    else {
+        std::cout << "Invalid number of command line arguements" << std::endl;
+        return 1;
+    }
+
+    SampleEngine engine;
+    if (!engine.loadDrumKit(sample_directory)) return 1;
+
+    //hits are timestamped on the clip timeline, so play them exactly at their time
+    engine.setLatency(0);
+
+    //render block by block, delivering each hit one block ahead as the haptic loop would
+    int rate = engine.getSampleRate();
+    long frames = long((hits.back().time+tail)*rate);
+    std::vector<float> audio(frames*SampleEngine::channels);
+    std::size_t next = 0;
+    for (long frame=0; frame<frames; frame+=period) {
+        while (next < hits.size() && hits[next].time*rate < frame+2*period) {
+            hits[next].hit.time = hits[next].time;
+            engine.send(hits[next++].hit);
+        }
+        int n = std::min<long>(period,frames-frame);
+        engine.render(&audio[frame*SampleEngine::channels],n,double(frame)/rate);
+    }
+
+    if (!saveWav(output_file,audio,SampleEngine::channels,rate)) {
+        std::cout << "Could not write " << output_file << std::endl;
+        return 1;
+    }
+    std::cout << "Rendered " << hits.size() << " hits, " << double(frames)/rate << " s to " << output_file << std::endl;
+    return 0;
+}
@@ -7,12 +7,16 @@
 #include <motor_communication.hpp>
 #include <fstream>
 #include <haptics.hpp>
+#include <audio_device.hpp>
+#include <osc_output.hpp>
+#include <latency_probe.hpp>
 #include <Eigen/Geometry>
 #include <float.h>
+#include <atomic>
 
 /// \brief convert OpenXR XrPosef to Eigen Transfrom
 /// \return transformation
-Eigen::Transform<float,3,Eigen::Affine> toTransform(XrPosef& pose) {
+Eigen::Transform<float,3,Eigen::Affine> toTransform(const XrPosef& pose) {
     //convert openXR types to Eigen
     Eigen::Quaternion<float,Eigen::AutoAlign> controller_orientation(pose.orientation.w,pose.orientation.x,pose.orientation.y,pose.orientation.z);
     Eigen::Vector3f controller_position(pose.position.x, pose.position.y, pose.position.z);
@@ -28,15 +32,28 @@ Eigen::Transform<float,3,Eigen::Affine> toTransform(XrPosef& pose) {
     return Twc;
 }
 
+/// \brief convert OpenXR XrVector3f to Eigen Vector3f
+/// \return vector
+Eigen::Vector3f toVector(const XrVector3f& v) {
+    return Eigen::Vector3f(v.x, v.y, v.z);
+}
+
 
 /// \brief initialize OpenXR program
+/// \param tracking - "headless" to track the controllers without rendering, "replay" to replay a scripted trajectory
+/// without a runtime, a csv file to replay its poses, empty to render as usual
+/// \param replay_real_time - hand out replayed frames at the display rate, false replays as fast as the loop runs
 /// \return pointer to program
-std::shared_ptr<IOpenXrProgram> initializeProgram() {
+std::shared_ptr<IOpenXrProgram> initializeProgram(const std::string& tracking, bool replay_real_time) {
     // Set graphics plugin, VR form factor, and VR view configuration
     std::shared_ptr<Options> options = std::make_shared<Options>();
     options->GraphicsPlugin = "Vulkan2";
     options->FormFactor = "Hmd";
     options->ViewConfiguration = "Stereo";
+    options->Headless = tracking == "headless";
+    options->Replay = !tracking.empty() && !options->Headless;
+    if (options->Replay && tracking != "replay") options->ReplayFile = tracking;
+    options->ReplayRealTime = replay_real_time;
     
     // Create platform-specific implementation.
     std::shared_ptr<IPlatformPlugin> platformPlugin = CreatePlatformPlugin_Xlib(options);
@@ -44,8 +61,8 @@ std::shared_ptr<IOpenXrProgram> initializeProgram() {
     // Create graphics API implementation.
     std::shared_ptr<IGraphicsPlugin> graphicsPlugin = CreateGraphicsPlugin_Vulkan(options, platformPlugin);
 
-    // Initialize the OpenXR program.
-    std::shared_ptr<IOpenXrProgram> program = CreateOpenXrProgram(options, platformPlugin, graphicsPlugin);
+    // Initialize the OpenXR program, or the replay standing in for it.
+    std::shared_ptr<IOpenXrProgram> program = options->Replay ? CreateReplayProgram(options) : CreateOpenXrProgram(options, platformPlugin, graphicsPlugin);
 
     program->CreateInstance();
     program->InitializeSystem();
@@ -55,33 +72,6 @@ std::shared_ptr<IOpenXrProgram> initializeProgram() {
     return program;
 }
 
-/// \brief calculate controller velocity in the z direction
-/// \param z_pos - current z position
-/// \return z velocity
-double calculateVelocity(double z_pos) {
-    static double z_i = 0;
-    static bool initialized = false;
-    static std::chrono::steady_clock::time_point time_start;
-
-    if (!initialized) {
-        z_i = z_pos;
-        time_start = std::chrono::steady_clock::now();
-        initialized = true;
-        return 0;
-    }
-
-    //calculate change in pose
-    double dz = abs(z_pos-z_i);
-    z_i = z_pos;
-
-    //calculate change in time
-    std::chrono::steady_clock::time_point time_stop = std::chrono::steady_clock::now();
-    double dt = std::chrono::duration_cast<std::chrono::duration<double>>(time_stop-time_start).count();
-    time_start = time_stop;
-    
-    return dz/dt;
-}
- 
 int main(int argc, char* argv[]) {
 
     //Constants
@@ -129,6 +119,18 @@ int main(int argc, char* argv[]) {
     std::string portname;
     std::string default_port = "/dev/ttyACM1";
 
+    //Sound output
+    std::string output_mode = "tcp";
+    std::string pd_host = "127.0.0.1";
+    int pd_port = 8080;
+    int osc_port = 9000;
+    std::string sample_directory = "../drum";
+    double lookahead_ms = 0;    //predictive trigger lookahead, 0 triggers on the observed crossing
+    std::string latency_file;   //latency report written at exit, empty disables instrumentation
+    double tracking_rate = 0;   //controller tracking thread rate [Hz], 0 samples the controller once per rendered frame
+    std::string tracking;       //controller source, see initializeProgram
+    bool replay_real_time = true;   //replay pacing, see initializeProgram
+
     //Parse command line arguements
     if (argc == 1) {
         portname = default_port;
@@ -136,17 +138,104 @@ int main(int argc, char* argv[]) {
     else if (argc == 2) {
         portname = argv[1];
     } 
+    else if (argc == 3) {
+        portname = argv[1];
+        output_mode = argv[2];
+    }
+    else if (argc == 4) {
+        portname = argv[1];
+        output_mode = argv[2];
+        sample_directory = argv[3];
+    }
+    else if (argc == 5) {
+        portname = argv[1];
+        output_mode = argv[2];
+        sample_directory = argv[3];
+        lookahead_ms = std::stod(argv[4]);
+    }
+    else if (argc == 6) {
+        portname = argv[1];
+        output_mode = argv[2];
+        sample_directory = argv[3];
+        lookahead_ms = std::stod(argv[4]);
+        latency_file = argv[5];
+    }
+    else if (argc == 7) {
+        portname = argv[1];
+        output_mode = argv[2];
+        sample_directory = argv[3];
+        lookahead_ms = std::stod(argv[4]);
+        latency_file = argv[5];
+        tracking_rate = std::stod(argv[6]);
+    }
+    else if (argc == 8) {
+        portname = argv[1];
+        output_mode = argv[2];
+        sample_directory = argv[3];
+        lookahead_ms = std::stod(argv[4]);
+        latency_file = argv[5];
+        tracking_rate = std::stod(argv[6]);
+        tracking = argv[7];
+    }
+    else if (argc == 9) {
+        portname = argv[1];
+        output_mode = argv[2];
+        sample_directory = argv[3];
+        lookahead_ms = std::stod(argv[4]);
+        latency_file = argv[5];
+        tracking_rate = std::stod(argv[6]);
+        tracking = argv[7];
+        replay_real_time = std::stoi(argv[8]) != 0;
+    }
     else {
         std::cout << "Invalid number of command line arguements" << std::endl;
         return 1;
     }
 
-    //Odrive setup
-    Odrive odrive(portname, 115200);
-    odrive.zeroEncoderPosition(0,0.25);
+    //Connect drums to Pure Data
+    std::unique_ptr<HitOutput> output;
+    if (output_mode == "tcp") output = std::make_unique<FudiClient>(pd_host,pd_port,FudiProtocol::TCP);
+    else if (output_mode == "udp") output = std::make_unique<FudiClient>(pd_host,pd_port,FudiProtocol::UDP);
+    else if (output_mode == "stdout") output = std::make_unique<StdoutOutput>();
+    else if (output_mode == "osc") output = std::make_unique<OscOutput>(pd_host,osc_port);
+    else if (output_mode == "engine") {
+        auto engine = std::make_unique<SampleEngine>();
+        if (!engine->loadDrumKit(sample_directory)) return 1;
+        output = std::move(engine);
+    }
+    else {
+        std::cout << "Unknown sound output " << output_mode << std::endl;
+        return 1;
+    }
+    //Stamp hits as they are handed to the sound output when instrumenting
+    LatencyProbe probe;
+    bool instrument = !latency_file.empty();
+    ProbedOutput probed_output(*output,probe);
+    HitOutput *drum_output = instrument ? &probed_output : output.get();
+
+    for (int i=0; i<drumkit.size(); i++) {
+        drumkit[i].setOutput(drum_output);
+        if (lookahead_ms > 0) drumkit[i].enablePredictiveTrigger(lookahead_ms/1000);
+    }
+
+    //Play the built in sampler on the sound card
+    std::unique_ptr<AudioDevice> audio;
+    if (output_mode == "engine") {
+        audio = std::make_unique<AudioDevice>(static_cast<SampleEngine&>(*output));
+        if (!audio->start()) return 1;
+    }
+
+    //Odrive setup, "none" runs without a motor and reports the torque it would have commanded instead
+    std::unique_ptr<Odrive> odrive;
+    if (portname != "none") {
+        odrive = std::make_unique<Odrive>(portname, 115200);
+        odrive->zeroEncoderPosition(0,0.25);
+    }
+    int torque_commands = 0;        //commands above 0
+    double max_torque = 0;          //largest command [Nm]
 
     //initialize openXR program
-    auto program = initializeProgram();
+    auto program = initializeProgram(tracking, replay_real_time);
 
     //world to world prime
     Eigen::Transform<float,3,Eigen::Affine> Tww_;
@@ -169,66 +258,148 @@ int main(int argc, char* argv[]) {
     //initialize exponential filter
     ExponentialFilter ef = ExponentialFilter(3,alpha);
 
-    bool exitRenderLoop = false;
-    bool requestRestart = false;
-    while (!exitRenderLoop) {
-        program->PollEvents(&exitRenderLoop, &requestRestart);
-        if (exitRenderLoop || requestRestart) {
-            break;
-        }
+    //last drumstick sample for swept contact detection
+    DrumstickState previous;
+    bool has_previous = false;
 
-        if (program->IsSessionRunning()) {
-            program->PollActions();
+    //Haptic loop for one controller sample located at time
+    auto processController = [&](const ControllerState& controller, XrTime time, bool hand_active) {
+        //move the sample onto the steady clock shared by hits, telemetry and latency stamps
+        double sample_time = program->toSteadyTime(time);
+        if (instrument) probe.beginSample(sample_time);
 
-            //Render and get controller data
-            XrTime displayTime = program->RenderFrame();
-            XrSpaceLocation pos = program->getControllerSpace(displayTime, hand);
+        //Create controller tranformation matrix
+        auto Twc = toTransform(controller.location.pose);
 
-            //Create controller tranformation matrix
-            auto Twc = toTransform(pos.pose);
+        //rotate controller to make +Z up
+        Twc.rotate(rot);
 
-            //rotate controller to make +Z up
-            Twc.rotate(rot);
+        //Define w_ frame at controller start position
+        if (!originSet && hand_active) {
+            Tww_ = Twc;
+            originSet = true;
+        }
 
-            //Define w_ frame at controller start position
-            if (!originSet && program->isHandActive(hand)) {
-                Tww_ = Twc;
-                originSet = true;
-            }
+        else if (originSet) {
 
-            else if (originSet) {
+            //calculate controller position in w_ frame
+            auto Tw_c = Tww_.inverse()*Twc;
 
-                //calculate controller position in w_ frame
-                auto Tw_c = Tww_.inverse()*Twc;
+            //calculate drumstick position in w_ frame
+            auto Tw_p = Tw_c*Tcp;
 
-                //calculate drumstick position in w_ frame
-                auto Tw_p = Tw_c*Tcp;
+            //get drumstick position
+            std::vector<double> drumstick_pos;
+            for (int i=0; i<3; i++) drumstick_pos.push_back(Tw_p.translation()(i));
 
-                //get drumstick position
-                std::vector<double> drumstick_pos;
-                for (int i=0; i<3; i++) drumstick_pos.push_back(Tw_p.translation()(i));
+            //lowpass filter drumstick position
+            ef.filterData(drumstick_pos);
+            auto filtered_drumstick_pos = ef.getForcastFloat();
+            if (instrument) probe.stamp(LatencyStage::Filter);
 
-                //lowpass filter drumstick position
-                ef.filterData(drumstick_pos);
-                auto filtered_drumstick_pos = ef.getForcastFloat();
+            //current drumstick sample
+            DrumstickState current;
+            current.time = sample_time;
+            current.position = filtered_drumstick_pos;
 
-                //get drumstick velocity
-                double vel = calculateVelocity(filtered_drumstick_pos[2]);
+            //get drumstick velocity from the tracker if available
+            const XrSpaceVelocityFlags velocity_valid = XR_SPACE_VELOCITY_LINEAR_VALID_BIT | XR_SPACE_VELOCITY_ANGULAR_VALID_BIT;
+            if ((controller.velocity.velocityFlags & velocity_valid) == velocity_valid) {
+                //velocity of drumstick tip in w frame
+                Eigen::Vector3f v_wp = geometry::pointVelocity(Twc, toVector(controller.velocity.linearVelocity), toVector(controller.velocity.angularVelocity), Tcp);
 
-                //calculate torque and send data to PD
-                double torque = 0;
-                for (int i=0; i<drumkit.size(); i++) {
-                    torque = std::max(torque,drumkit[i].update(filtered_drumstick_pos,vel));
-                }
+                //express in w_ frame
+                current.velocity = Tww_.inverse().linear()*v_wp;
+            }
+            //otherwise finite difference the filtered position
+            else if (has_previous && current.time > previous.time) {
+                current.velocity = (current.position-previous.position)/(current.time-previous.time);
+            }
+            if (!has_previous) {
+                previous = current;
+                has_previous = true;
+            }
 
-                //Command motor
-                odrive.sendTorqueCommand(0,torque);
+            //calculate torque and send data to PD, sweeping the tip between samples so fast strikes are not missed
+            double torque = 0;
+            for (int i=0; i<drumkit.size(); i++) {
+                torque = std::max(torque,drumkit[i].update(previous,current));
+            }
+            previous = current;
+            if (instrument) probe.stamp(LatencyStage::Update);
+
+            //Command motor
+            if (odrive) odrive->sendTorqueCommand(0,torque);
+            if (torque > 0) torque_commands++;
+            max_torque = std::max(max_torque,torque);
+            if (instrument) probe.stamp(LatencyStage::Torque);
+
+            //Stream the frame to OSC receivers
+            if (output_mode == "osc") {
+                auto osc = static_cast<OscOutput*>(output.get());
+                osc->beginFrame(current.time);
+                osc->addStick(current.position.data(),current.velocity.data());
+                osc->addTorque(torque);
+                osc->sendFrame();
+            }
+        }
+    };
+
+    //Run the haptic loop on every tracked sample, separate from rendering
+    std::atomic<bool> haptics_running{true};
+    std::thread haptic_thread;
+    if (tracking_rate > 0) {
+        program->startTracking(tracking_rate);
+        haptic_thread = std::thread([&]() {
+            uint64_t last_sample = 0;
+            while (haptics_running) {
+                //sleep until the tracking thread publishes, waking now and then to notice shutdown
+                TrackedControllerState tracked = program->waitTrackedControllerState(hand,last_sample,std::chrono::milliseconds(10));
+                if (tracked.sample == last_sample) continue;
+                last_sample = tracked.sample;
+                bool hand_active = (tracked.state.location.locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) != 0;
+                processController(tracked.state, tracked.time, hand_active);
+            }
+        });
+    }
+
+    bool exitRenderLoop = false;
+    bool requestRestart = false;
+    while (!exitRenderLoop) {
+        program->PollEvents(&exitRenderLoop, &requestRestart);
+        if (exitRenderLoop || requestRestart) {
+            break;
+        }
+
+        if (program->IsSessionRunning()) {
+            program->PollActions();
+
+            //Render, the tracking thread feeds the haptic loop when enabled
+            XrTime displayTime = program->RenderFrame();
+            if (tracking_rate <= 0) {
+                processController(program->getControllerState(displayTime, hand), displayTime, program->isHandActive(hand));
             }
             
         }
         // Throttle loop since xrWaitFrame won't be called.
         else std::this_thread::sleep_for(std::chrono::milliseconds(250));
     }
+
+    //Stop the haptic loop before reporting
+    haptics_running = false;
+    if (haptic_thread.joinable()) haptic_thread.join();
+    program->stopTracking();
+
+    //Write latency report
+    if (instrument) {
+        std::ofstream report(latency_file);
+        probe.report(report);
+    }
+
+    //Report the torque no motor received
+    if (!odrive) {
+        std::cout << "Torque without a motor: " << torque_commands << " commands above 0, max " << max_torque << " Nm" << std::endl;
+    }
     
     return 0;
 }
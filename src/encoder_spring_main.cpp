@@ -1,6 +1,7 @@
 #include <nuhal/uart.h>
 #include <nuhal/uart_linux.h>
 #include <motor_communication.hpp>
+#include <haptic_engine.hpp>
 #include <iostream>
 #include <signal.h>
 #include <chrono>
@@ -45,6 +46,14 @@ int main(int argc, char* argv[]) {
     double k = 0.1666667;   //[Nm/deg]
     double torque = 0;
 
+    //spring engaged past one revolution
+    SpringWall spring;
+    spring.position = 360;
+    spring.stiffness = k;
+    spring.max_force = 0.5;
+    HapticScene scene;
+    scene.add(spring);
+
     if (loggingEnabled) {    
         datafile.open(filename);
         datafile << "Time (s)" << "," << " Current (A)" << "," << " Torque (Nm)" << "," << " Angle (degrees)" << "," << " K = " << k  << " (N/deg)" <<"\n";
@@ -62,27 +71,14 @@ int main(int argc, char* argv[]) {
         odrive.updateEncoderReadings(0);
         const double theta = odrive.getEncoderPosition()*360;
 
-        //spring displacement
-        double displacement = 0;
-
         //get motor current
         odrive.updateMotorCurrent(0);
         double current = odrive.getCurrent();
 
-        //engage spring
-        if (theta > 360) {
-
-            //calculate and clamp torque
-            displacement = theta-360;
-            torque = k*displacement;
-            torque = std::max(0.0,std::min(torque,0.5));
-
-            //command motor
-            odrive.sendTorqueCommand(0,-torque);
-        }
-
-        //deactivate spring
-        else odrive.sendTorqueCommand(0,0);
+        //calculate torque and command motor
+        double command = scene.evaluate(theta,0);
+        torque = std::abs(command);
+        odrive.sendTorqueCommand(0,command);
 
         //track time
         std::chrono::steady_clock::time_point loop_stop = std::chrono::steady_clock::now();
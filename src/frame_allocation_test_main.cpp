@@ -0,0 +1,94 @@
+#include "pch.h"
+#include "common.h"
+#include "options.h"
+#include "platformplugin.h"
+#include "graphicsplugin.h"
+#include "frame_layer.h"
+#include "openxr_program.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+
+//every heap allocation in the process goes through these, so the count covers anything a frame reaches
+static std::atomic<size_t> allocation_count{0};
+
+void* operator new(std::size_t size) {
+    allocation_count++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+//exit code ctest reports as skipped, see SKIP_RETURN_CODE in CMakeLists.txt
+const int skipped = 77;
+
+int main() {
+    const int warmup_frames = 10;
+    const double duration = 5;   //seconds of scripted trajectory, 450 frames at 90 Hz
+
+    std::shared_ptr<Options> options = std::make_shared<Options>();
+    options->Replay = true;
+    options->ReplayDuration = duration;
+    options->ReplayRealTime = false;
+    options->PipelineCachePath = "";
+
+    //render through the Vulkan plugin when the machine has a device, otherwise only replay the frame loop
+    std::shared_ptr<IGraphicsPlugin> graphicsPlugin = CreateGraphicsPlugin_Vulkan(options, nullptr);
+    std::shared_ptr<IOpenXrProgram> program = CreateReplayProgram(options, graphicsPlugin);
+    bool rendering = true;
+    try {
+        program->CreateInstance();
+        program->InitializeSystem();
+    }
+    catch (const std::exception &e) {
+        std::cout << "No Vulkan device, frames are not rendered: " << e.what() << std::endl;
+        graphicsPlugin.reset();
+        program = CreateReplayProgram(options);
+        program->CreateInstance();
+        program->InitializeSystem();
+        rendering = false;
+    }
+    program->InitializeSession();
+    program->CreateSwapchains();
+
+    //the spaces of a headset session that stay lost, every visualized reference space and an active hand, recorded
+    //as OpenXrProgram::RenderLayer records them
+    const size_t lost_spaces = 7;
+    LocateFailureLog locate_failures;
+    locate_failures.Reset(lost_spaces);
+
+    //drumkit's render loop
+    int frames = 0;
+    size_t before = 0, after = 0;
+    bool exit_render_loop = false;
+    while (!exit_render_loop) {
+        bool request_restart = false;
+        program->PollEvents(&exit_render_loop, &request_restart);
+        if (exit_render_loop) break;
+        if (!program->IsSessionRunning()) continue;
+
+        program->PollActions();
+        XrTime display_time = program->RenderFrame();
+        for (size_t i=0; i<lost_spaces; i++) {
+            locate_failures.Record(i, XR_ERROR_TIME_INVALID, "a lost space");
+        }
+        for (auto hand : {Side::LEFT, Side::RIGHT}) {
+            program->getControllerState(display_time, hand);
+        }
+
+        frames++;
+        if (frames == warmup_frames) before = allocation_count;
+        after = allocation_count;
+    }
+    const int steady_frames = frames - warmup_frames;
+    const size_t allocations = after - before;
+
+    std::cout << allocations << " heap allocations over " << steady_frames << " steady-state frames"
+              << (rendering ? ", rendered offscreen" : "") << std::endl;
+    if (steady_frames <= 0 || allocations != 0) return 1;
+    return rendering ? 0 : skipped;
+}
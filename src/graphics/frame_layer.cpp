@@ -0,0 +1,46 @@
+#include "pch.h"
+#include "common.h"
+#include "logger.h"
+#include "frame_layer.h"
+
+void FrameLayer::AddCube(const XrSpaceLocation& location, const XrVector3f& scale) {
+    if ((location.locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) != 0 &&
+        (location.locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT) != 0) {
+        cubes.push_back(Cube{location.pose, scale});
+    }
+}
+
+void FrameLayer::Submit(XrSpace space) {
+    layer.space = space;
+    layer.viewCount = (uint32_t)projectionViews.size();
+    layer.views = projectionViews.data();
+    layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader*>(&layer));
+}
+
+void LocateFailureLog::Record(size_t index, XrResult result, const char* description) {
+    if (result == m_results[index]) {
+        return;
+    }
+    m_results[index] = result;
+    if (!XR_UNQUALIFIED_SUCCESS(result)) {
+        Log::Write(Log::Level::Verbose, Fmt("Unable to locate %s in app space: %d", description, result));
+    }
+}
+
+void CollectGpuTimings(IGraphicsPlugin& graphicsPlugin, FrameTimingHistory& timings) {
+    std::array<GpuPassTiming, 16> gpuTimings;
+    size_t count;
+    while ((count = graphicsPlugin.CollectGpuTimings(gpuTimings.data(), gpuTimings.size())) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            FrameTiming* timing = timings.find(gpuTimings[i].frame);
+            if (timing == nullptr) {
+                continue;
+            }
+            for (size_t view = 0; view < FrameTiming::MaxViews; view++) {
+                if ((gpuTimings[i].viewMask & (1u << view)) != 0) {
+                    timing->viewGpuMs[view] = gpuTimings[i].durationMs;
+                }
+            }
+        }
+    }
+}
@@ -9,6 +9,9 @@
 
 #include "xr_linear.h"
 #include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 
 #define SPV_PREFIX
 #define SPV_SUFFIX
@@ -88,7 +91,39 @@ inline VkResult CheckVkResult(VkResult res, const char* originator = nullptr, co
 #define CHECK_VKRESULT(res, cmdStr) CheckVkResult(res, cmdStr, FILE_AND_LINE);
 
 
+// A range of a memory block handed out by MemoryAllocator.
+struct MemoryAllocation {
+    VkDeviceMemory memory{VK_NULL_HANDLE};
+    VkDeviceSize offset{0};
+    VkDeviceSize size{0};
+    uint8_t* mapped{nullptr};  // Host address of offset, null unless the memory is host visible.
+    size_t block{0};
+};
+
+// Sub-allocates buffers and images from large VkDeviceMemory blocks, so creating a resource rarely reaches
+// vkAllocateMemory, which is slow and limited in count by the driver. Blocks are kept per memory type and resource kind:
+// buffers and images never share a block, so bufferImageGranularity never applies. Host-visible blocks are mapped once
+// when allocated and stay mapped, and blocks are only released with the allocator. Not thread-safe.
 struct MemoryAllocator {
+    enum class Kind { Buffer, Image };
+
+    static constexpr VkDeviceSize BlockSize = 32 * 1024 * 1024;
+
+    MemoryAllocator() = default;
+
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+    ~MemoryAllocator() {
+        for (Block& block : m_blocks) {
+            if (block.mapped != nullptr) {
+                vkUnmapMemory(m_vkDevice, block.memory);
+            }
+            vkFreeMemory(m_vkDevice, block.memory, nullptr);
+        }
+        m_blocks.clear();
+    }
+
     void Init(VkPhysicalDevice physicalDevice, VkDevice device) {
         m_vkDevice = device;
         vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memProps);
@@ -96,27 +131,141 @@ struct MemoryAllocator {
 
     static const VkFlags defaultFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 
-    void Allocate(VkMemoryRequirements const& memReqs, VkDeviceMemory* mem, VkFlags flags = defaultFlags,
-                  const void* pNext = nullptr) const {
+    MemoryAllocation Allocate(VkMemoryRequirements const& memReqs, Kind kind, VkFlags flags = defaultFlags) {
+        const uint32_t memoryType = FindMemoryType(memReqs, flags);
+
+        // First fit in an existing block of the same type and kind
+        for (size_t i = 0; i < m_blocks.size(); ++i) {
+            Block& block = m_blocks[i];
+            if (block.memoryType == memoryType && block.kind == kind) {
+                MemoryAllocation allocation;
+                if (Suballocate(block, memReqs, &allocation)) {
+                    allocation.block = i;
+                    return allocation;
+                }
+            }
+        }
+
+        // Resources larger than a block get a block of their own
+        Block block;
+        block.memoryType = memoryType;
+        block.kind = kind;
+        block.size = std::max(BlockSize, memReqs.size);
+        VkMemoryAllocateInfo memAlloc{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+        memAlloc.allocationSize = block.size;
+        memAlloc.memoryTypeIndex = memoryType;
+        CHECK_VKCMD(vkAllocateMemory(m_vkDevice, &memAlloc, nullptr, &block.memory));
+        if ((m_memProps.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0u) {
+            CHECK_VKCMD(vkMapMemory(m_vkDevice, block.memory, 0, VK_WHOLE_SIZE, 0, (void**)&block.mapped));
+        }
+        block.free.push_back({0, block.size});
+        Log::Write(Log::Level::Verbose, Fmt("Allocated %llu byte %s block of memory type %u", (unsigned long long)block.size,
+                                            kind == Kind::Buffer ? "buffer" : "image", memoryType));
+        m_blocks.push_back(block);
+
+        MemoryAllocation allocation;
+        CHECK(Suballocate(m_blocks.back(), memReqs, &allocation));
+        allocation.block = m_blocks.size() - 1;
+        return allocation;
+    }
+
+    // Allocate memory for a buffer and bind it.
+    MemoryAllocation AllocateBuffer(VkDevice device, VkBuffer buf, VkFlags flags = defaultFlags) {
+        VkMemoryRequirements memReq = {};
+        vkGetBufferMemoryRequirements(device, buf, &memReq);
+        MemoryAllocation allocation = Allocate(memReq, Kind::Buffer, flags);
+        CHECK_VKCMD(vkBindBufferMemory(device, buf, allocation.memory, allocation.offset));
+        return allocation;
+    }
+
+    // Allocate memory for an image and bind it.
+    MemoryAllocation AllocateImage(VkDevice device, VkImage image, VkFlags flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
+        VkMemoryRequirements memReq = {};
+        vkGetImageMemoryRequirements(device, image, &memReq);
+        MemoryAllocation allocation = Allocate(memReq, Kind::Image, flags);
+        CHECK_VKCMD(vkBindImageMemory(device, image, allocation.memory, allocation.offset));
+        return allocation;
+    }
+
+    // Return a range to its block, merging it with free neighbours. The resource bound to it must be destroyed first.
+    void Free(MemoryAllocation& allocation) {
+        if (allocation.memory == VK_NULL_HANDLE) {
+            return;
+        }
+        std::vector<Range>& free = m_blocks[allocation.block].free;
+        auto next = std::lower_bound(free.begin(), free.end(), allocation.offset,
+                                     [](const Range& r, VkDeviceSize offset) { return r.offset < offset; });
+        auto it = free.insert(next, {allocation.offset, allocation.size});
+        if (std::next(it) != free.end() && it->offset + it->size == std::next(it)->offset) {
+            it->size += std::next(it)->size;
+            free.erase(std::next(it));
+        }
+        if (it != free.begin() && std::prev(it)->offset + std::prev(it)->size == it->offset) {
+            std::prev(it)->size += it->size;
+            free.erase(it);
+        }
+        allocation = {};
+    }
+
+   private:
+    struct Range {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+
+    struct Block {
+        VkDeviceMemory memory{VK_NULL_HANDLE};
+        VkDeviceSize size{0};
+        uint32_t memoryType{0};
+        Kind kind{Kind::Buffer};
+        uint8_t* mapped{nullptr};
+        std::vector<Range> free;  // Sorted by offset, never adjacent.
+    };
+
+    uint32_t FindMemoryType(VkMemoryRequirements const& memReqs, VkFlags flags) const {
         // Search memtypes to find first index with those properties
         for (uint32_t i = 0; i < m_memProps.memoryTypeCount; ++i) {
             if ((memReqs.memoryTypeBits & (1 << i)) != 0u) {
                 // Type is available, does it match user properties?
                 if ((m_memProps.memoryTypes[i].propertyFlags & flags) == flags) {
-                    VkMemoryAllocateInfo memAlloc{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, pNext};
-                    memAlloc.allocationSize = memReqs.size;
-                    memAlloc.memoryTypeIndex = i;
-                    CHECK_VKCMD(vkAllocateMemory(m_vkDevice, &memAlloc, nullptr, mem));
-                    return;
+                    return i;
                 }
             }
         }
         THROW("Memory format not supported");
     }
 
-   private:
+    // Carve an aligned range out of the first free range that fits, keeping the space before and after it free.
+    static bool Suballocate(Block& block, VkMemoryRequirements const& memReqs, MemoryAllocation* allocation) {
+        const VkDeviceSize alignment = std::max<VkDeviceSize>(memReqs.alignment, 1);
+        for (size_t i = 0; i < block.free.size(); ++i) {
+            const Range range = block.free[i];
+            const VkDeviceSize offset = (range.offset + alignment - 1) / alignment * alignment;
+            if (offset + memReqs.size > range.offset + range.size) {
+                continue;
+            }
+            const Range before{range.offset, offset - range.offset};
+            const Range after{offset + memReqs.size, range.offset + range.size - (offset + memReqs.size)};
+            block.free.erase(block.free.begin() + i);
+            if (after.size > 0) {
+                block.free.insert(block.free.begin() + i, after);
+            }
+            if (before.size > 0) {
+                block.free.insert(block.free.begin() + i, before);
+            }
+
+            allocation->memory = block.memory;
+            allocation->offset = offset;
+            allocation->size = memReqs.size;
+            allocation->mapped = block.mapped != nullptr ? block.mapped + offset : nullptr;
+            return true;
+        }
+        return false;
+    }
+
     VkDevice m_vkDevice{VK_NULL_HANDLE};
     VkPhysicalDeviceMemoryProperties m_memProps{};
+    std::vector<Block> m_blocks;
 };
 
 // CmdBuffer - manage VkCommandBuffer state
@@ -343,13 +492,87 @@ struct ShaderProgram {
     }
 };
 
+// Copies host data into device-local buffers through host-visible staging buffers. Copies are recorded as they are
+// added and submitted together by Flush, which waits for them and releases the staging memory. Meant for static data
+// uploaded at load time.
+struct StagingUploader {
+    StagingUploader() = default;
+
+    StagingUploader(const StagingUploader&) = delete;
+    StagingUploader& operator=(const StagingUploader&) = delete;
+
+    ~StagingUploader() { Release(); }
+
+    void Init(VkDevice device, MemoryAllocator* memAllocator, uint32_t queueFamilyIndex) {
+        m_vkDevice = device;
+        m_memAllocator = memAllocator;
+        if (!m_cmdBuffer.Init(device, queueFamilyIndex)) THROW("Failed to create upload command buffer");
+    }
+
+    void Copy(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+        if (m_cmdBuffer.state == CmdBuffer::CmdBufferState::Initialized) {
+            m_cmdBuffer.Begin();
+        }
+
+        Staging staging;
+        VkBufferCreateInfo bufInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+        bufInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        bufInfo.size = size;
+        CHECK_VKCMD(vkCreateBuffer(m_vkDevice, &bufInfo, nullptr, &staging.buf));
+        staging.mem = m_memAllocator->AllocateBuffer(m_vkDevice, staging.buf);
+        memcpy(staging.mem.mapped, data, (size_t)size);
+        m_staging.push_back(staging);
+
+        VkBufferCopy region{0, dstOffset, size};
+        vkCmdCopyBuffer(m_cmdBuffer.buf, staging.buf, dst, 1, &region);
+    }
+
+    void Flush(VkQueue queue) {
+        if (m_cmdBuffer.state != CmdBuffer::CmdBufferState::Recording) {
+            return;
+        }
+
+        // Make the copies visible to vertex input before any later submission reads them
+        VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+        vkCmdPipelineBarrier(m_cmdBuffer.buf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1,
+                             &barrier, 0, nullptr, 0, nullptr);
+
+        m_cmdBuffer.End();
+        m_cmdBuffer.Exec(queue);
+        if (!m_cmdBuffer.Wait()) THROW("Staging upload did not finish executing");
+        m_cmdBuffer.Reset();
+        Release();
+    }
+
+   private:
+    struct Staging {
+        VkBuffer buf{VK_NULL_HANDLE};
+        MemoryAllocation mem;
+    };
+
+    void Release() {
+        for (Staging& staging : m_staging) {
+            vkDestroyBuffer(m_vkDevice, staging.buf, nullptr);
+            m_memAllocator->Free(staging.mem);
+        }
+        m_staging.clear();
+    }
+
+    VkDevice m_vkDevice{VK_NULL_HANDLE};
+    MemoryAllocator* m_memAllocator{nullptr};
+    CmdBuffer m_cmdBuffer;
+    std::vector<Staging> m_staging;
+};
+
 // VertexBuffer base class
 struct VertexBufferBase {
     VkBuffer idxBuf{VK_NULL_HANDLE};
-    VkDeviceMemory idxMem{VK_NULL_HANDLE};
+    MemoryAllocation idxMem{};
     VkBuffer vtxBuf{VK_NULL_HANDLE};
-    VkDeviceMemory vtxMem{VK_NULL_HANDLE};
-    VkVertexInputBindingDescription bindDesc{};
+    MemoryAllocation vtxMem{};
+    std::vector<VkVertexInputBindingDescription> bindDesc{};
     std::vector<VkVertexInputAttributeDescription> attrDesc{};
     struct {
         uint32_t idx;
@@ -363,21 +586,15 @@ struct VertexBufferBase {
             if (idxBuf != VK_NULL_HANDLE) {
                 vkDestroyBuffer(m_vkDevice, idxBuf, nullptr);
             }
-            if (idxMem != VK_NULL_HANDLE) {
-                vkFreeMemory(m_vkDevice, idxMem, nullptr);
-            }
             if (vtxBuf != VK_NULL_HANDLE) {
                 vkDestroyBuffer(m_vkDevice, vtxBuf, nullptr);
             }
-            if (vtxMem != VK_NULL_HANDLE) {
-                vkFreeMemory(m_vkDevice, vtxMem, nullptr);
-            }
+            m_memAllocator->Free(idxMem);
+            m_memAllocator->Free(vtxMem);
         }
         idxBuf = VK_NULL_HANDLE;
-        idxMem = VK_NULL_HANDLE;
         vtxBuf = VK_NULL_HANDLE;
-        vtxMem = VK_NULL_HANDLE;
-        bindDesc = {};
+        bindDesc.clear();
         attrDesc.clear();
         count = {0, 0};
         m_vkDevice = nullptr;
@@ -387,44 +604,45 @@ struct VertexBufferBase {
     VertexBufferBase& operator=(const VertexBufferBase&) = delete;
     VertexBufferBase(VertexBufferBase&&) = delete;
     VertexBufferBase& operator=(VertexBufferBase&&) = delete;
-    void Init(VkDevice device, const MemoryAllocator* memAllocator, const std::vector<VkVertexInputAttributeDescription>& attr) {
+    void Init(VkDevice device, MemoryAllocator* memAllocator, const std::vector<VkVertexInputAttributeDescription>& attr) {
         m_vkDevice = device;
         m_memAllocator = memAllocator;
         attrDesc = attr;
     }
 
+    // Feed the attributes of binding from a per-instance buffer, see InstanceBuffer.
+    void AddInstanceBinding(uint32_t binding, uint32_t stride) {
+        bindDesc.push_back({binding, stride, VK_VERTEX_INPUT_RATE_INSTANCE});
+    }
+
    protected:
     VkDevice m_vkDevice{VK_NULL_HANDLE};
-    void AllocateBufferMemory(VkBuffer buf, VkDeviceMemory* mem) const {
-        VkMemoryRequirements memReq = {};
-        vkGetBufferMemoryRequirements(m_vkDevice, buf, &memReq);
-        m_memAllocator->Allocate(memReq, mem);
+    MemoryAllocation AllocateBufferMemory(VkBuffer buf, VkFlags flags) const {
+        return m_memAllocator->AllocateBuffer(m_vkDevice, buf, flags);
     }
 
    private:
-    const MemoryAllocator* m_memAllocator{nullptr};
+    MemoryAllocator* m_memAllocator{nullptr};
 };
 
 // VertexBuffer template to wrap the indices and vertices
+// Host-visible buffers (the default) are updated in place through their persistent mapping. Pass
+// VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT for static geometry and fill it with a StagingUploader instead.
 template <typename T>
 struct VertexBuffer : public VertexBufferBase {
-    bool Create(uint32_t idxCount, uint32_t vtxCount) {
+    bool Create(uint32_t idxCount, uint32_t vtxCount, VkFlags memFlags = MemoryAllocator::defaultFlags) {
         VkBufferCreateInfo bufInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
-        bufInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+        bufInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
         bufInfo.size = sizeof(uint16_t) * idxCount;
         CHECK_VKCMD(vkCreateBuffer(m_vkDevice, &bufInfo, nullptr, &idxBuf));
-        AllocateBufferMemory(idxBuf, &idxMem);
-        CHECK_VKCMD(vkBindBufferMemory(m_vkDevice, idxBuf, idxMem, 0));
+        idxMem = AllocateBufferMemory(idxBuf, memFlags);
 
-        bufInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        bufInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
         bufInfo.size = sizeof(T) * vtxCount;
         CHECK_VKCMD(vkCreateBuffer(m_vkDevice, &bufInfo, nullptr, &vtxBuf));
-        AllocateBufferMemory(vtxBuf, &vtxMem);
-        CHECK_VKCMD(vkBindBufferMemory(m_vkDevice, vtxBuf, vtxMem, 0));
+        vtxMem = AllocateBufferMemory(vtxBuf, memFlags);
 
-        bindDesc.binding = 0;
-        bindDesc.stride = sizeof(T);
-        bindDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        bindDesc.push_back({0, sizeof(T), VK_VERTEX_INPUT_RATE_VERTEX});
 
         count = {idxCount, vtxCount};
 
@@ -432,22 +650,79 @@ struct VertexBuffer : public VertexBufferBase {
     }
 
     void UpdateIndicies(const uint16_t* data, uint32_t elements, uint32_t offset = 0) {
-        uint16_t* map = nullptr;
-        CHECK_VKCMD(vkMapMemory(m_vkDevice, idxMem, sizeof(map[0]) * offset, sizeof(map[0]) * elements, 0, (void**)&map));
-        for (size_t i = 0; i < elements; ++i) {
-            map[i] = data[i];
-        }
-        vkUnmapMemory(m_vkDevice, idxMem);
+        CHECK_MSG(idxMem.mapped != nullptr, "Index buffer is not host visible");
+        memcpy(idxMem.mapped + sizeof(uint16_t) * offset, data, sizeof(uint16_t) * elements);
     }
 
     void UpdateVertices(const T* data, uint32_t elements, uint32_t offset = 0) {
-        T* map = nullptr;
-        CHECK_VKCMD(vkMapMemory(m_vkDevice, vtxMem, sizeof(map[0]) * offset, sizeof(map[0]) * elements, 0, (void**)&map));
-        for (size_t i = 0; i < elements; ++i) {
-            map[i] = data[i];
+        CHECK_MSG(vtxMem.mapped != nullptr, "Vertex buffer is not host visible");
+        memcpy(vtxMem.mapped + sizeof(T) * offset, data, sizeof(T) * elements);
+    }
+};
+
+// Per-instance vertex data for one command buffer's draws. The memory stays mapped for the buffer's lifetime, so
+// filling it is a plain write. It must only be refilled once the GPU has finished the draws that read it.
+template <typename T>
+struct InstanceBuffer {
+    VkBuffer buf{VK_NULL_HANDLE};
+    MemoryAllocation mem{};
+    T* data{nullptr};
+    uint32_t capacity{0};
+
+    InstanceBuffer() = default;
+
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+    InstanceBuffer(InstanceBuffer&&) = delete;
+    InstanceBuffer& operator=(InstanceBuffer&&) = delete;
+
+    ~InstanceBuffer() { Release(); }
+
+    void Init(VkDevice device, MemoryAllocator* memAllocator) {
+        m_vkDevice = device;
+        m_memAllocator = memAllocator;
+    }
+
+    // Make room for count instances. Grows by doubling, so a steady scene stops reallocating after the first frames.
+    void Reserve(uint32_t count) {
+        if (count <= capacity) {
+            return;
         }
-        vkUnmapMemory(m_vkDevice, vtxMem);
+        uint32_t newCapacity = std::max<uint32_t>(capacity, 64);
+        while (newCapacity < count) {
+            newCapacity *= 2;
+        }
+        Release();
+
+        VkBufferCreateInfo bufInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+        bufInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        bufInfo.size = sizeof(T) * newCapacity;
+        CHECK_VKCMD(vkCreateBuffer(m_vkDevice, &bufInfo, nullptr, &buf));
+        mem = m_memAllocator->AllocateBuffer(m_vkDevice, buf);
+        data = reinterpret_cast<T*>(mem.mapped);
+        capacity = newCapacity;
     }
+
+   private:
+    void Release() {
+        if (m_vkDevice != nullptr) {
+            if (buf != VK_NULL_HANDLE) {
+                vkDestroyBuffer(m_vkDevice, buf, nullptr);
+            }
+            m_memAllocator->Free(mem);
+        }
+        buf = VK_NULL_HANDLE;
+        data = nullptr;
+        capacity = 0;
+    }
+
+    VkDevice m_vkDevice{VK_NULL_HANDLE};
+    MemoryAllocator* m_memAllocator{nullptr};
+};
+
+// Per-instance data of a cube draw, matching the Model attribute of vert.glsl.
+struct CubeInstance {
+    XrMatrix4x4f model;
 };
 
 // RenderPass wrapper
@@ -458,7 +733,8 @@ struct RenderPass {
 
     RenderPass() = default;
 
-    bool Create(VkDevice device, VkFormat aColorFmt, VkFormat aDepthFmt) {
+    // viewCount > 1 renders every view in one pass with VK_KHR_multiview, one array layer per view.
+    bool Create(VkDevice device, VkFormat aColorFmt, VkFormat aDepthFmt, uint32_t viewCount = 1) {
         m_vkDevice = device;
         colorFmt = aColorFmt;
         depthFmt = aDepthFmt;
@@ -508,6 +784,31 @@ struct RenderPass {
             subpass.pDepthStencilAttachment = &depthRef;
         }
 
+        // Several frames can be in flight on the queue and they share the depth buffer, so order each pass's attachment
+        // writes after those of the passes submitted before it.
+        VkSubpassDependency dependency{};
+        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.dstSubpass = 0;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                  VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependency.dstStageMask = dependency.srcStageMask;
+        dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                                   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        rpInfo.dependencyCount = 1;
+        rpInfo.pDependencies = &dependency;
+
+        // The views see the same scene from nearby eyes, so let the implementation share work between them.
+        const uint32_t viewMask = (1u << viewCount) - 1;
+        VkRenderPassMultiviewCreateInfoKHR multiviewInfo{VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO_KHR};
+        multiviewInfo.subpassCount = 1;
+        multiviewInfo.pViewMasks = &viewMask;
+        multiviewInfo.correlationMaskCount = 1;
+        multiviewInfo.pCorrelationMasks = &viewMask;
+        if (viewCount > 1) {
+            rpInfo.pNext = &multiviewInfo;
+        }
+
         CHECK_VKCMD(vkCreateRenderPass(m_vkDevice, &rpInfo, nullptr, &pass));
 
         return true;
@@ -588,8 +889,11 @@ struct RenderTarget {
         swap(m_vkDevice, other.m_vkDevice);
         return *this;
     }
-    void Create(VkDevice device, VkImage aColorImage, VkImage aDepthImage, VkExtent2D size, RenderPass& renderPass) {
+    // layerCount > 1 views the images as arrays for a multiview render pass.
+    void Create(VkDevice device, VkImage aColorImage, VkImage aDepthImage, VkExtent2D size, RenderPass& renderPass,
+                uint32_t layerCount = 1) {
         m_vkDevice = device;
+        const VkImageViewType viewType = layerCount > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
 
         colorImage = aColorImage;
         depthImage = aDepthImage;
@@ -601,7 +905,7 @@ struct RenderTarget {
         if (colorImage != VK_NULL_HANDLE) {
             VkImageViewCreateInfo colorViewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
             colorViewInfo.image = colorImage;
-            colorViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            colorViewInfo.viewType = viewType;
             colorViewInfo.format = renderPass.colorFmt;
             colorViewInfo.components.r = VK_COMPONENT_SWIZZLE_R;
             colorViewInfo.components.g = VK_COMPONENT_SWIZZLE_G;
@@ -611,7 +915,7 @@ struct RenderTarget {
             colorViewInfo.subresourceRange.baseMipLevel = 0;
             colorViewInfo.subresourceRange.levelCount = 1;
             colorViewInfo.subresourceRange.baseArrayLayer = 0;
-            colorViewInfo.subresourceRange.layerCount = 1;
+            colorViewInfo.subresourceRange.layerCount = layerCount;
             CHECK_VKCMD(vkCreateImageView(m_vkDevice, &colorViewInfo, nullptr, &colorView));
             attachments[attachmentCount++] = colorView;
         }
@@ -620,7 +924,7 @@ struct RenderTarget {
         if (depthImage != VK_NULL_HANDLE) {
             VkImageViewCreateInfo depthViewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
             depthViewInfo.image = depthImage;
-            depthViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            depthViewInfo.viewType = viewType;
             depthViewInfo.format = renderPass.depthFmt;
             depthViewInfo.components.r = VK_COMPONENT_SWIZZLE_R;
             depthViewInfo.components.g = VK_COMPONENT_SWIZZLE_G;
@@ -630,7 +934,7 @@ struct RenderTarget {
             depthViewInfo.subresourceRange.baseMipLevel = 0;
             depthViewInfo.subresourceRange.levelCount = 1;
             depthViewInfo.subresourceRange.baseArrayLayer = 0;
-            depthViewInfo.subresourceRange.layerCount = 1;
+            depthViewInfo.subresourceRange.layerCount = layerCount;
             CHECK_VKCMD(vkCreateImageView(m_vkDevice, &depthViewInfo, nullptr, &depthView));
             attachments[attachmentCount++] = depthView;
         }
@@ -641,7 +945,7 @@ struct RenderTarget {
         fbInfo.pAttachments = attachments.data();
         fbInfo.width = size.width;
         fbInfo.height = size.height;
-        fbInfo.layers = 1;
+        fbInfo.layers = 1;  // Multiview selects layers through the view mask.
         CHECK_VKCMD(vkCreateFramebuffer(m_vkDevice, &fbInfo, nullptr, &fb));
     }
 
@@ -671,11 +975,12 @@ struct PipelineLayout {
     void Create(VkDevice device) {
         m_vkDevice = device;
 
-        // MVP matrix is a push_constant
+        // View-projection matrix is a push_constant, one per view for multiview. Two matrices fill the guaranteed 128 bytes.
+        // Model matrices come from the instance buffer.
         VkPushConstantRange pcr = {};
         pcr.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
         pcr.offset = 0;
-        pcr.size = 4 * 4 * sizeof(float);
+        pcr.size = 2 * 4 * 4 * sizeof(float);
 
         VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
         pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
@@ -692,6 +997,172 @@ struct PipelineLayout {
     VkDevice m_vkDevice{VK_NULL_HANDLE};
 };
 
+// VkPipelineCache kept on disk between runs, so pipelines compiled once are not compiled again at the next startup or
+// session restart. The file prefixes the driver's cache data with the identity of the device and driver that produced
+// it, and data from any other device, driver version or cache layout is discarded rather than handed to the driver.
+struct PipelineCache {
+    VkPipelineCache cache{VK_NULL_HANDLE};
+
+    PipelineCache() = default;
+
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    ~PipelineCache() {
+        if (m_vkDevice != nullptr && cache != VK_NULL_HANDLE) {
+            vkDestroyPipelineCache(m_vkDevice, cache, nullptr);
+        }
+        cache = VK_NULL_HANDLE;
+        m_vkDevice = nullptr;
+    }
+
+    // Create the cache, seeded from path when it holds data for this device. An empty path keeps it in memory only.
+    void Create(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path) {
+        m_vkDevice = device;
+        m_path = path;
+        vkGetPhysicalDeviceProperties(physicalDevice, &m_props);
+
+        std::vector<char> data = Load();
+        VkPipelineCacheCreateInfo cacheInfo{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+        cacheInfo.initialDataSize = data.size();
+        cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+        CHECK_VKCMD(vkCreatePipelineCache(m_vkDevice, &cacheInfo, nullptr, &cache));
+    }
+
+    // Write the cache to disk, through a temporary file so a crash never leaves a truncated cache behind.
+    // Failures are only logged, since losing the cache costs nothing but startup time.
+    void Save() const {
+        if (cache == VK_NULL_HANDLE || m_path.empty()) {
+            return;
+        }
+        size_t size = 0;
+        std::vector<char> data;
+        VkResult res = vkGetPipelineCacheData(m_vkDevice, cache, &size, nullptr);
+        if (res == VK_SUCCESS) {
+            data.resize(size);
+            res = vkGetPipelineCacheData(m_vkDevice, cache, &size, data.data());
+        }
+        if (res != VK_SUCCESS) {
+            Log::Write(Log::Level::Warning, Fmt("Unable to read pipeline cache data: %s", vkResultString(res).c_str()));
+            return;
+        }
+
+        const std::filesystem::path directory = std::filesystem::path(m_path).parent_path();
+        std::error_code error;
+        if (!directory.empty() && !std::filesystem::create_directories(directory, error) && error) {
+            Log::Write(Log::Level::Warning, Fmt("Unable to create pipeline cache directory %s: %s", directory.c_str(),
+                                                error.message().c_str()));
+            return;
+        }
+
+        const std::string tmpPath = m_path + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            FileHeader header = Identity();
+            header.dataSize = size;
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(data.data(), size);
+            if (!file) {
+                Log::Write(Log::Level::Warning, Fmt("Unable to write pipeline cache %s", tmpPath.c_str()));
+                return;
+            }
+        }
+        if (std::rename(tmpPath.c_str(), m_path.c_str()) != 0) {
+            Log::Write(Log::Level::Warning, Fmt("Unable to replace pipeline cache %s", m_path.c_str()));
+            return;
+        }
+        Log::Write(Log::Level::Info, Fmt("Saved %zu byte pipeline cache to %s", size, m_path.c_str()));
+    }
+
+   private:
+    static constexpr uint32_t Magic = 0x43505648;  // "HVPC"
+    static constexpr uint32_t FormatVersion = 1;
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t formatVersion;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint32_t reserved;
+        uint64_t dataSize;
+    };
+    static_assert(sizeof(FileHeader) == 48, "FileHeader must not contain padding");
+
+    FileHeader Identity() const {
+        FileHeader header{Magic, FormatVersion, m_props.vendorID, m_props.deviceID, m_props.driverVersion, {}, 0, 0};
+        memcpy(header.pipelineCacheUUID, m_props.pipelineCacheUUID, VK_UUID_SIZE);
+        return header;
+    }
+
+    // The cache data from disk, or nothing if it is missing, truncated or from another device or driver.
+    std::vector<char> Load() const {
+        if (m_path.empty()) {
+            return {};
+        }
+        std::ifstream file(m_path, std::ios::binary);
+        if (!file) {
+            Log::Write(Log::Level::Info, Fmt("No pipeline cache at %s, starting empty", m_path.c_str()));
+            return {};
+        }
+
+        FileHeader header{};
+        const FileHeader expected = Identity();
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || header.magic != expected.magic || header.formatVersion != expected.formatVersion ||
+            header.vendorID != expected.vendorID || header.deviceID != expected.deviceID ||
+            header.driverVersion != expected.driverVersion ||
+            memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+            Log::Write(Log::Level::Info, Fmt("Pipeline cache %s is from another device or driver, ignoring it", m_path.c_str()));
+            return {};
+        }
+
+        // Size the buffer from the file rather than trusting the header, so a corrupt size cannot cause a huge allocation.
+        const std::streamoff dataStart = file.tellg();
+        file.seekg(0, std::ios::end);
+        const std::streamoff remaining = file.tellg() - dataStart;
+        file.seekg(dataStart);
+        if (!file || remaining < 0 || header.dataSize != uint64_t(remaining)) {
+            Log::Write(Log::Level::Warning, Fmt("Pipeline cache %s is truncated or corrupt, ignoring it", m_path.c_str()));
+            return {};
+        }
+
+        std::vector<char> data(header.dataSize);
+        file.read(data.data(), data.size());
+        if (!file || !ValidCacheData(data)) {
+            Log::Write(Log::Level::Warning, Fmt("Pipeline cache %s is corrupt, ignoring it", m_path.c_str()));
+            return {};
+        }
+        Log::Write(Log::Level::Info, Fmt("Loaded %zu byte pipeline cache from %s", data.size(), m_path.c_str()));
+        return data;
+    }
+
+    // Check the header the driver itself puts in front of the cache data.
+    bool ValidCacheData(const std::vector<char>& data) const {
+        struct {
+            uint32_t headerSize;
+            uint32_t headerVersion;
+            uint32_t vendorID;
+            uint32_t deviceID;
+            uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        } header;
+        static_assert(sizeof(header) == 16 + VK_UUID_SIZE, "Unexpected pipeline cache header layout");
+        if (data.size() < sizeof(header)) {
+            return false;
+        }
+        memcpy(&header, data.data(), sizeof(header));
+        return header.headerSize >= sizeof(header) && header.headerSize <= data.size() &&
+               header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && header.vendorID == m_props.vendorID &&
+               header.deviceID == m_props.deviceID &&
+               memcmp(header.pipelineCacheUUID, m_props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+    VkDevice m_vkDevice{VK_NULL_HANDLE};
+    VkPhysicalDeviceProperties m_props{};
+    std::string m_path;
+};
+
 // Pipeline wrapper for rendering pipeline state
 struct Pipeline {
     VkPipeline pipe{VK_NULL_HANDLE};
@@ -703,7 +1174,7 @@ struct Pipeline {
     void Dynamic(VkDynamicState state) { dynamicStateEnables.emplace_back(state); }
 
     void Create(VkDevice device, VkExtent2D size, const PipelineLayout& layout, const RenderPass& rp, const ShaderProgram& sp,
-                const VertexBufferBase& vb) {
+                const VertexBufferBase& vb, VkPipelineCache pipelineCache = VK_NULL_HANDLE) {
         m_vkDevice = device;
 
         VkPipelineDynamicStateCreateInfo dynamicState{VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
@@ -711,8 +1182,8 @@ struct Pipeline {
         dynamicState.pDynamicStates = dynamicStateEnables.data();
 
         VkPipelineVertexInputStateCreateInfo vi{VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
-        vi.vertexBindingDescriptionCount = 1;
-        vi.pVertexBindingDescriptions = &vb.bindDesc;
+        vi.vertexBindingDescriptionCount = (uint32_t)vb.bindDesc.size();
+        vi.pVertexBindingDescriptions = vb.bindDesc.data();
         vi.vertexAttributeDescriptionCount = (uint32_t)vb.attrDesc.size();
         vi.pVertexAttributeDescriptions = vb.attrDesc.data();
 
@@ -801,7 +1272,7 @@ struct Pipeline {
         pipeInfo.layout = layout.layout;
         pipeInfo.renderPass = rp.pass;
         pipeInfo.subpass = 0;
-        CHECK_VKCMD(vkCreateGraphicsPipelines(m_vkDevice, VK_NULL_HANDLE, 1, &pipeInfo, nullptr, &pipe));
+        CHECK_VKCMD(vkCreateGraphicsPipelines(m_vkDevice, pipelineCache, 1, &pipeInfo, nullptr, &pipe));
     }
 
     void Release() {
@@ -819,7 +1290,7 @@ struct Pipeline {
 };
 
 struct DepthBuffer {
-    VkDeviceMemory depthMemory{VK_NULL_HANDLE};
+    MemoryAllocation depthMemory{};
     VkImage depthImage{VK_NULL_HANDLE};
 
     DepthBuffer() = default;
@@ -829,12 +1300,9 @@ struct DepthBuffer {
             if (depthImage != VK_NULL_HANDLE) {
                 vkDestroyImage(m_vkDevice, depthImage, nullptr);
             }
-            if (depthMemory != VK_NULL_HANDLE) {
-                vkFreeMemory(m_vkDevice, depthMemory, nullptr);
-            }
+            m_memAllocator->Free(depthMemory);
         }
         depthImage = VK_NULL_HANDLE;
-        depthMemory = VK_NULL_HANDLE;
         m_vkDevice = nullptr;
     }
 
@@ -844,6 +1312,8 @@ struct DepthBuffer {
         swap(depthImage, other.depthImage);
         swap(depthMemory, other.depthMemory);
         swap(m_vkDevice, other.m_vkDevice);
+        swap(m_memAllocator, other.m_memAllocator);
+        swap(m_layerCount, other.m_layerCount);
     }
     DepthBuffer& operator=(DepthBuffer&& other) noexcept {
         if (&other == this) {
@@ -856,12 +1326,15 @@ struct DepthBuffer {
         swap(depthImage, other.depthImage);
         swap(depthMemory, other.depthMemory);
         swap(m_vkDevice, other.m_vkDevice);
+        swap(m_memAllocator, other.m_memAllocator);
+        swap(m_layerCount, other.m_layerCount);
         return *this;
     }
 
     void Create(VkDevice device, MemoryAllocator* memAllocator, VkFormat depthFormat,
                 const XrSwapchainCreateInfo& swapchainCreateInfo) {
         m_vkDevice = device;
+        m_memAllocator = memAllocator;
 
         VkExtent2D size = {swapchainCreateInfo.width, swapchainCreateInfo.height};
 
@@ -872,7 +1345,7 @@ struct DepthBuffer {
         imageInfo.extent.height = size.height;
         imageInfo.extent.depth = 1;
         imageInfo.mipLevels = 1;
-        imageInfo.arrayLayers = 1;
+        imageInfo.arrayLayers = swapchainCreateInfo.arraySize;
         imageInfo.format = depthFormat;
         imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -881,10 +1354,8 @@ struct DepthBuffer {
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         CHECK_VKCMD(vkCreateImage(device, &imageInfo, nullptr, &depthImage));
 
-        VkMemoryRequirements memRequirements{};
-        vkGetImageMemoryRequirements(device, depthImage, &memRequirements);
-        memAllocator->Allocate(memRequirements, &depthMemory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        CHECK_VKCMD(vkBindImageMemory(device, depthImage, depthMemory, 0));
+        depthMemory = memAllocator->AllocateImage(device, depthImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        m_layerCount = swapchainCreateInfo.arraySize;
     }
 
     void TransitionLayout(CmdBuffer* cmdBuffer, VkImageLayout newLayout) {
@@ -898,7 +1369,7 @@ struct DepthBuffer {
         depthBarrier.oldLayout = m_vkLayout;
         depthBarrier.newLayout = newLayout;
         depthBarrier.image = depthImage;
-        depthBarrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+        depthBarrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, m_layerCount};
         vkCmdPipelineBarrier(cmdBuffer->buf, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, nullptr,
                              0, nullptr, 1, &depthBarrier);
 
@@ -910,7 +1381,9 @@ struct DepthBuffer {
 
    private:
     VkDevice m_vkDevice{VK_NULL_HANDLE};
+    MemoryAllocator* m_memAllocator{nullptr};
     VkImageLayout m_vkLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    uint32_t m_layerCount{1};
 };
 
 struct SwapchainImageContext {
@@ -920,6 +1393,8 @@ struct SwapchainImageContext {
     std::vector<XrSwapchainImageVulkan2KHR> swapchainImages;
     std::vector<RenderTarget> renderTarget;
     VkExtent2D size{};
+    uint32_t layerCount{1};  // Views rendered per image, more than 1 for multiview.
+    uint32_t viewMask{1};    // Views this swapchain holds, bit i for view i.
     DepthBuffer depthBuffer{};
     RenderPass rp{};
     Pipeline pipe{};
@@ -929,17 +1404,19 @@ struct SwapchainImageContext {
 
     std::vector<XrSwapchainImageBaseHeader*> Create(VkDevice device, MemoryAllocator* memAllocator, uint32_t capacity,
                                                     const XrSwapchainCreateInfo& swapchainCreateInfo, const PipelineLayout& layout,
-                                                    const ShaderProgram& sp, const VertexBuffer<Geometry::Vertex>& vb) {
+                                                    const ShaderProgram& sp, const VertexBuffer<Geometry::Vertex>& vb,
+                                                    VkPipelineCache pipelineCache) {
         m_vkDevice = device;
 
         size = {swapchainCreateInfo.width, swapchainCreateInfo.height};
+        layerCount = swapchainCreateInfo.arraySize;
         VkFormat colorFormat = (VkFormat)swapchainCreateInfo.format;
         VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
         // XXX handle swapchainCreateInfo.sampleCount
 
         depthBuffer.Create(m_vkDevice, memAllocator, depthFormat, swapchainCreateInfo);
-        rp.Create(m_vkDevice, colorFormat, depthFormat);
-        pipe.Create(m_vkDevice, size, layout, rp, sp, vb);
+        rp.Create(m_vkDevice, colorFormat, depthFormat, layerCount);
+        pipe.Create(m_vkDevice, size, layout, rp, sp, vb, pipelineCache);
 
         swapchainImages.resize(capacity);
         renderTarget.resize(capacity);
@@ -959,7 +1436,7 @@ struct SwapchainImageContext {
 
     void BindRenderTarget(uint32_t index, VkRenderPassBeginInfo* renderPassBeginInfo) {
         if (renderTarget[index].fb == VK_NULL_HANDLE) {
-            renderTarget[index].Create(m_vkDevice, swapchainImages[index].image, depthBuffer.depthImage, size, rp);
+            renderTarget[index].Create(m_vkDevice, swapchainImages[index].image, depthBuffer.depthImage, size, rp, layerCount);
         }
         renderPassBeginInfo->renderPass = rp.pass;
         renderPassBeginInfo->framebuffer = renderTarget[index].fb;
@@ -972,10 +1449,29 @@ struct SwapchainImageContext {
 };
 
 struct VulkanGraphicsPlugin : public IGraphicsPlugin {
-    VulkanGraphicsPlugin(const std::shared_ptr<Options>& /*unused*/, std::shared_ptr<IPlatformPlugin> /*unused*/) {
+    VulkanGraphicsPlugin(const std::shared_ptr<Options>& options, std::shared_ptr<IPlatformPlugin> /*unused*/)
+        : m_cmdBufferCount(std::max<uint32_t>(1, options->CommandBufferCount)), m_pipelineCachePath(options->PipelineCachePath) {
         m_graphicsBinding.type = GetGraphicsBindingType();
     };
 
+    ~VulkanGraphicsPlugin() override {
+        // Command buffers may still be executing; let them finish before members release what they use.
+        if (m_vkDevice != VK_NULL_HANDLE) {
+            vkDeviceWaitIdle(m_vkDevice);
+            if (m_timestampPool != VK_NULL_HANDLE) {
+                vkDestroyQueryPool(m_vkDevice, m_timestampPool, nullptr);
+            }
+            // Offscreen images outlive the framebuffers and views made of them.
+            m_swapchainImageContextMap.clear();
+            m_swapchainImageContexts.clear();
+            for (OffscreenImage& offscreenImage : m_offscreenImages) {
+                vkDestroyImage(m_vkDevice, offscreenImage.image, nullptr);
+                m_memAllocator.Free(offscreenImage.memory);
+            }
+        }
+        m_pipelineCache.Save();
+    }
+
     std::vector<std::string> GetInstanceExtensions() const override { return {XR_KHR_VULKAN_ENABLE2_EXTENSION_NAME}; }
 
     // Note: The output must not outlive the input - this modifies the input and returns a collection of views into that modified
@@ -1022,8 +1518,58 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
         XrGraphicsRequirementsVulkan2KHR graphicsRequirements{XR_TYPE_GRAPHICS_REQUIREMENTS_VULKAN2_KHR};
         CHECK_XRCMD(GetVulkanGraphicsRequirements2KHR(instance, systemId, &graphicsRequirements));
 
-        VkResult err;
+        CreateVulkanInstance([&](const VkInstanceCreateInfo& instInfo) {
+            VkResult err;
+            XrVulkanInstanceCreateInfoKHR createInfo{XR_TYPE_VULKAN_INSTANCE_CREATE_INFO_KHR};
+            createInfo.systemId = systemId;
+            createInfo.pfnGetInstanceProcAddr = &vkGetInstanceProcAddr;
+            createInfo.vulkanCreateInfo = &instInfo;
+            createInfo.vulkanAllocator = nullptr;
+            CHECK_XRCMD(CreateVulkanInstanceKHR(instance, &createInfo, &m_vkInstance, &err));
+            CHECK_VKCMD(err);
+        });
+
+        XrVulkanGraphicsDeviceGetInfoKHR deviceGetInfo{XR_TYPE_VULKAN_GRAPHICS_DEVICE_GET_INFO_KHR};
+        deviceGetInfo.systemId = systemId;
+        deviceGetInfo.vulkanInstance = m_vkInstance;
+        CHECK_XRCMD(GetVulkanGraphicsDevice2KHR(instance, &deviceGetInfo, &m_vkPhysicalDevice));
+
+        CreateVulkanDevice([&](const VkDeviceCreateInfo& deviceInfo) {
+            VkResult err;
+            XrVulkanDeviceCreateInfoKHR deviceCreateInfo{XR_TYPE_VULKAN_DEVICE_CREATE_INFO_KHR};
+            deviceCreateInfo.systemId = systemId;
+            deviceCreateInfo.pfnGetInstanceProcAddr = &vkGetInstanceProcAddr;
+            deviceCreateInfo.vulkanCreateInfo = &deviceInfo;
+            deviceCreateInfo.vulkanPhysicalDevice = m_vkPhysicalDevice;
+            deviceCreateInfo.vulkanAllocator = nullptr;
+            CHECK_XRCMD(CreateVulkanDeviceKHR(instance, &deviceCreateInfo, &m_vkDevice, &err));
+            CHECK_VKCMD(err);
+        });
+    }
+
+    void InitializeHeadlessDevice() override {
+        CreateVulkanInstance([&](const VkInstanceCreateInfo& instInfo) {
+            CHECK_VKCMD(vkCreateInstance(&instInfo, nullptr, &m_vkInstance));
+        });
+
+        // Without a runtime to pick the adapter, take the first one. With only a CPU driver installed that is lavapipe.
+        uint32_t physicalDeviceCount = 0;
+        CHECK_VKCMD(vkEnumeratePhysicalDevices(m_vkInstance, &physicalDeviceCount, nullptr));
+        CHECK_MSG(physicalDeviceCount > 0, "No Vulkan physical device found");
+        std::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCount);
+        CHECK_VKCMD(vkEnumeratePhysicalDevices(m_vkInstance, &physicalDeviceCount, physicalDevices.data()));
+        m_vkPhysicalDevice = physicalDevices[0];
+        VkPhysicalDeviceProperties deviceProps{};
+        vkGetPhysicalDeviceProperties(m_vkPhysicalDevice, &deviceProps);
+        Log::Write(Log::Level::Info, Fmt("Headless Vulkan device: %s", deviceProps.deviceName));
+
+        CreateVulkanDevice([&](const VkDeviceCreateInfo& deviceInfo) {
+            CHECK_VKCMD(vkCreateDevice(m_vkPhysicalDevice, &deviceInfo, nullptr, &m_vkDevice));
+        });
+    }
 
+    // Create m_vkInstance with the layers and extensions the plugin uses, through create, and hook up debug reports.
+    void CreateVulkanInstance(const std::function<void(const VkInstanceCreateInfo&)>& create) {
         std::vector<const char*> layers;
 #if !defined(NDEBUG)
         const char* const validationLayerName = GetValidationLayerName();
@@ -1034,8 +1580,27 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
         }
 #endif
 
+        // Debug reports are optional: not every driver (or loader without layers) exposes the extension.
+        uint32_t instanceExtensionCount = 0;
+        CHECK_VKCMD(vkEnumerateInstanceExtensionProperties(nullptr, &instanceExtensionCount, nullptr));
+        std::vector<VkExtensionProperties> instanceExtensionProps(instanceExtensionCount);
+        CHECK_VKCMD(vkEnumerateInstanceExtensionProperties(nullptr, &instanceExtensionCount, instanceExtensionProps.data()));
+        auto instanceExtensionSupported = [&](const char* name) {
+            return std::any_of(instanceExtensionProps.begin(), instanceExtensionProps.end(),
+                               [name](const VkExtensionProperties& p) { return strcmp(p.extensionName, name) == 0; });
+        };
+        const bool debugReportSupported = instanceExtensionSupported(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+        // VK_KHR_multiview on a 1.0 instance depends on this one, and it lets the multiview feature be queried.
+        m_physicalDeviceProperties2Enabled =
+            instanceExtensionSupported(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+
         std::vector<const char*> extensions;
-        extensions.push_back("VK_EXT_debug_report");
+        if (debugReportSupported) {
+            extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+        }
+        if (m_physicalDeviceProperties2Enabled) {
+            extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+        }
 
         VkApplicationInfo appInfo{VK_STRUCTURE_TYPE_APPLICATION_INFO};
         appInfo.pApplicationName = "hello_xr";
@@ -1051,14 +1616,12 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
         instInfo.enabledExtensionCount = (uint32_t)extensions.size();
         instInfo.ppEnabledExtensionNames = extensions.empty() ? nullptr : extensions.data();
 
-        XrVulkanInstanceCreateInfoKHR createInfo{XR_TYPE_VULKAN_INSTANCE_CREATE_INFO_KHR};
-        createInfo.systemId = systemId;
-        createInfo.pfnGetInstanceProcAddr = &vkGetInstanceProcAddr;
-        createInfo.vulkanCreateInfo = &instInfo;
-        createInfo.vulkanAllocator = nullptr;
-        CHECK_XRCMD(CreateVulkanInstanceKHR(instance, &createInfo, &m_vkInstance, &err));
-        CHECK_VKCMD(err);
+        create(instInfo);
 
+        if (!debugReportSupported) {
+            Log::Write(Log::Level::Warning, "VK_EXT_debug_report unavailable, Vulkan messages will not be logged");
+            return;
+        }
         vkCreateDebugReportCallbackEXT =
             (PFN_vkCreateDebugReportCallbackEXT)vkGetInstanceProcAddr(m_vkInstance, "vkCreateDebugReportCallbackEXT");
         vkDestroyDebugReportCallbackEXT =
@@ -1072,12 +1635,10 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
         debugInfo.pfnCallback = debugReportThunk;
         debugInfo.pUserData = this;
         CHECK_VKCMD(vkCreateDebugReportCallbackEXT(m_vkInstance, &debugInfo, nullptr, &m_vkDebugReporter));
+    }
 
-        XrVulkanGraphicsDeviceGetInfoKHR deviceGetInfo{XR_TYPE_VULKAN_GRAPHICS_DEVICE_GET_INFO_KHR};
-        deviceGetInfo.systemId = systemId;
-        deviceGetInfo.vulkanInstance = m_vkInstance;
-        CHECK_XRCMD(GetVulkanGraphicsDevice2KHR(instance, &deviceGetInfo, &m_vkPhysicalDevice));
-
+    // Create m_vkDevice on m_vkPhysicalDevice through create, then the resources rendering needs.
+    void CreateVulkanDevice(const std::function<void(const VkDeviceCreateInfo&)>& create) {
         VkDeviceQueueCreateInfo queueInfo{VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
         float queuePriorities = 0;
         queueInfo.queueCount = 1;
@@ -1096,12 +1657,51 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
             }
         }
 
+        // Timestamps wrap at the valid bits of the queue; none means the queue cannot time passes.
+        const uint32_t timestampValidBits = queueFamilyProps[m_queueFamilyIndex].timestampValidBits;
+        m_timestampMask = timestampValidBits >= 64 ? ~uint64_t(0) : (uint64_t(1) << timestampValidBits) - 1;
+        VkPhysicalDeviceProperties deviceProps{};
+        vkGetPhysicalDeviceProperties(m_vkPhysicalDevice, &deviceProps);
+        m_timestampPeriodNs = deviceProps.limits.timestampPeriod;
+        m_timestampsSupported = timestampValidBits > 0;
+
         std::vector<const char*> deviceExtensions;
 
+        // Render both eyes in one pass when the device supports multiview. The extension requires the feature, and on a
+        // 1.0 instance VK_KHR_get_physical_device_properties2, through which the feature is queried.
+        uint32_t deviceExtensionCount = 0;
+        CHECK_VKCMD(vkEnumerateDeviceExtensionProperties(m_vkPhysicalDevice, nullptr, &deviceExtensionCount, nullptr));
+        std::vector<VkExtensionProperties> deviceExtensionProps(deviceExtensionCount);
+        CHECK_VKCMD(vkEnumerateDeviceExtensionProperties(m_vkPhysicalDevice, nullptr, &deviceExtensionCount,
+                                                         deviceExtensionProps.data()));
+        m_multiviewSupported =
+            m_physicalDeviceProperties2Enabled &&
+            std::any_of(deviceExtensionProps.begin(), deviceExtensionProps.end(), [](const VkExtensionProperties& p) {
+                return strcmp(p.extensionName, VK_KHR_MULTIVIEW_EXTENSION_NAME) == 0;
+            });
+        VkPhysicalDeviceMultiviewFeaturesKHR multiviewFeatures{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES_KHR};
+        if (m_multiviewSupported) {
+            auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(m_vkInstance,
+                                                                                          "vkGetPhysicalDeviceFeatures2KHR");
+            VkPhysicalDeviceFeatures2KHR features2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR};
+            features2.pNext = &multiviewFeatures;
+            if (getFeatures2 != nullptr) {
+                getFeatures2(m_vkPhysicalDevice, &features2);
+            }
+            m_multiviewSupported = multiviewFeatures.multiview == VK_TRUE;
+        }
+        if (m_multiviewSupported) {
+            deviceExtensions.push_back(VK_KHR_MULTIVIEW_EXTENSION_NAME);
+        }
+        Log::Write(Log::Level::Info, Fmt("Vulkan multiview %s", m_multiviewSupported ? "supported" : "unsupported"));
+
         VkPhysicalDeviceFeatures features{};
         // features.samplerAnisotropy = VK_TRUE;
 
         VkDeviceCreateInfo deviceInfo{VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+        if (m_multiviewSupported) {
+            deviceInfo.pNext = &multiviewFeatures;
+        }
         deviceInfo.queueCreateInfoCount = 1;
         deviceInfo.pQueueCreateInfos = &queueInfo;
         deviceInfo.enabledLayerCount = 0;
@@ -1110,14 +1710,7 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
         deviceInfo.ppEnabledExtensionNames = deviceExtensions.empty() ? nullptr : deviceExtensions.data();
         deviceInfo.pEnabledFeatures = &features;
 
-        XrVulkanDeviceCreateInfoKHR deviceCreateInfo{XR_TYPE_VULKAN_DEVICE_CREATE_INFO_KHR};
-        deviceCreateInfo.systemId = systemId;
-        deviceCreateInfo.pfnGetInstanceProcAddr = &vkGetInstanceProcAddr;
-        deviceCreateInfo.vulkanCreateInfo = &deviceInfo;
-        deviceCreateInfo.vulkanPhysicalDevice = m_vkPhysicalDevice;
-        deviceCreateInfo.vulkanAllocator = nullptr;
-        CHECK_XRCMD(CreateVulkanDeviceKHR(instance, &deviceCreateInfo, &m_vkDevice, &err));
-        CHECK_VKCMD(err);
+        create(deviceInfo);
 
         vkGetDeviceQueue(m_vkDevice, queueInfo.queueFamilyIndex, 0, &m_vkQueue);
 
@@ -1147,23 +1740,64 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
         m_shaderProgram.LoadVertexShader(vertexSPIRV);
         m_shaderProgram.LoadFragmentShader(fragmentSPIRV);
 
+        if (m_multiviewSupported) {
+            // Same as vert.spv but picks the MVP for gl_ViewIndex
+            std::vector<uint32_t> multiviewVertexSPIRV = SPV_PREFIX
+#include "vert_multiview.spv"
+                SPV_SUFFIX;
+            if (multiviewVertexSPIRV.empty()) THROW("Failed to compile multiview vertex shader");
+            m_multiviewShaderProgram.Init(m_vkDevice);
+            m_multiviewShaderProgram.LoadVertexShader(multiviewVertexSPIRV);
+            m_multiviewShaderProgram.LoadFragmentShader(fragmentSPIRV);
+        }
+
         // Semaphore to block on draw complete
         VkSemaphoreCreateInfo semInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
         CHECK_VKCMD(vkCreateSemaphore(m_vkDevice, &semInfo, nullptr, &m_vkDrawDone));
 
-        if (!m_cmdBuffer.Init(m_vkDevice, m_queueFamilyIndex)) THROW("Failed to create command buffer");
+        m_cmdBuffers = std::vector<CmdBuffer>(m_cmdBufferCount);
+        for (CmdBuffer& cmdBuffer : m_cmdBuffers) {
+            if (!cmdBuffer.Init(m_vkDevice, m_queueFamilyIndex)) THROW("Failed to create command buffer");
+        }
+        m_instanceBuffers = std::vector<InstanceBuffer<CubeInstance>>(m_cmdBufferCount);
+        for (InstanceBuffer<CubeInstance>& instanceBuffer : m_instanceBuffers) {
+            instanceBuffer.Init(m_vkDevice, &m_memAllocator);
+        }
 
         m_pipelineLayout.Create(m_vkDevice);
+        m_pipelineCache.Create(m_vkPhysicalDevice, m_vkDevice, m_pipelineCachePath);
+
+        // Two timestamps, before and after the render pass, per command buffer
+        if (m_timestampsSupported) {
+            VkQueryPoolCreateInfo queryPoolInfo{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+            queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            queryPoolInfo.queryCount = 2 * m_cmdBufferCount;
+            CHECK_VKCMD(vkCreateQueryPool(m_vkDevice, &queryPoolInfo, nullptr, &m_timestampPool));
+            m_passQueries.resize(m_cmdBufferCount);
+        } else {
+            Log::Write(Log::Level::Warning, "Queue does not support timestamps, GPU pass timing disabled");
+        }
 
         static_assert(sizeof(Geometry::Vertex) == 24, "Unexpected Vertex size");
+        static_assert(sizeof(CubeInstance) == 64, "Unexpected CubeInstance size");
+        // The model matrix is read as four column attributes from binding 1.
         m_drawBuffer.Init(m_vkDevice, &m_memAllocator,
                           {{0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Geometry::Vertex, Position)},
-                           {1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Geometry::Vertex, Color)}});
+                           {1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Geometry::Vertex, Color)},
+                           {2, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 0},
+                           {3, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 4 * sizeof(float)},
+                           {4, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 8 * sizeof(float)},
+                           {5, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 12 * sizeof(float)}});
+        m_drawBuffer.AddInstanceBinding(1, sizeof(CubeInstance));
         uint32_t numCubeIdicies = sizeof(Geometry::c_cubeIndices) / sizeof(Geometry::c_cubeIndices[0]);
         uint32_t numCubeVerticies = sizeof(Geometry::c_cubeVertices) / sizeof(Geometry::c_cubeVertices[0]);
-        m_drawBuffer.Create(numCubeIdicies, numCubeVerticies);
-        m_drawBuffer.UpdateIndicies(Geometry::c_cubeIndices, numCubeIdicies, 0);
-        m_drawBuffer.UpdateVertices(Geometry::c_cubeVertices, numCubeVerticies, 0);
+        // The cube never changes, so keep it in device-local memory
+        m_drawBuffer.Create(numCubeIdicies, numCubeVerticies, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        StagingUploader uploader;
+        uploader.Init(m_vkDevice, &m_memAllocator, m_queueFamilyIndex);
+        uploader.Copy(m_drawBuffer.idxBuf, 0, Geometry::c_cubeIndices, sizeof(Geometry::c_cubeIndices));
+        uploader.Copy(m_drawBuffer.vtxBuf, 0, Geometry::c_cubeVertices, sizeof(Geometry::c_cubeVertices));
+        uploader.Flush(m_vkQueue);
     }
 
     int64_t SelectColorSwapchainFormat(const std::vector<int64_t>& runtimeFormats) const override {
@@ -1193,8 +1827,15 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
         m_swapchainImageContexts.emplace_back(GetSwapchainImageType());
         SwapchainImageContext& swapchainImageContext = m_swapchainImageContexts.back();
 
+        // Swapchains are created in view order: one per view, or a single array swapchain holding all of them.
+        swapchainImageContext.viewMask =
+            swapchainCreateInfo.arraySize > 1 ? (1u << swapchainCreateInfo.arraySize) - 1 : 1u << m_singleViewSwapchains++;
+
+        // Array swapchains hold one view per layer and are drawn with the multiview shader.
+        const ShaderProgram& shaderProgram = swapchainCreateInfo.arraySize > 1 ? m_multiviewShaderProgram : m_shaderProgram;
         std::vector<XrSwapchainImageBaseHeader*> bases = swapchainImageContext.Create(
-            m_vkDevice, &m_memAllocator, capacity, swapchainCreateInfo, m_pipelineLayout, m_shaderProgram, m_drawBuffer);
+            m_vkDevice, &m_memAllocator, capacity, swapchainCreateInfo, m_pipelineLayout, shaderProgram, m_drawBuffer,
+            m_pipelineCache.cache);
 
         // Map every swapchainImage base pointer to this context
         for (auto& base : bases) {
@@ -1204,18 +1845,83 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
         return bases;
     }
 
-    void RenderView(const XrCompositionLayerProjectionView& layerView, const XrSwapchainImageBaseHeader* swapchainImage,
-                    int64_t /*swapchainFormat*/, const std::vector<Cube>& cubes) override {
-        CHECK(layerView.subImage.imageArrayIndex == 0);  // Texture arrays not supported.
+    std::vector<XrSwapchainImageBaseHeader*> AllocateOffscreenImages(uint32_t capacity,
+                                                                    const XrSwapchainCreateInfo& swapchainCreateInfo) override {
+        std::vector<XrSwapchainImageBaseHeader*> bases = AllocateSwapchainImageStructs(capacity, swapchainCreateInfo);
 
+        VkImageCreateInfo imageInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = {swapchainCreateInfo.width, swapchainCreateInfo.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = swapchainCreateInfo.arraySize;
+        imageInfo.format = (VkFormat)swapchainCreateInfo.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        // The render pass expects what a runtime hands out: images already in the color attachment layout.
+        CmdBuffer cmdBuffer;
+        if (!cmdBuffer.Init(m_vkDevice, m_queueFamilyIndex)) THROW("Failed to create layout command buffer");
+        cmdBuffer.Begin();
+        std::vector<VkImageMemoryBarrier> barriers;
+        for (XrSwapchainImageBaseHeader* base : bases) {
+            OffscreenImage offscreenImage;
+            CHECK_VKCMD(vkCreateImage(m_vkDevice, &imageInfo, nullptr, &offscreenImage.image));
+            offscreenImage.memory = m_memAllocator.AllocateImage(m_vkDevice, offscreenImage.image);
+            m_offscreenImages.push_back(offscreenImage);
+            reinterpret_cast<XrSwapchainImageVulkan2KHR*>(base)->image = offscreenImage.image;
+
+            VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+            barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = offscreenImage.image;
+            barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, swapchainCreateInfo.arraySize};
+            barriers.push_back(barrier);
+        }
+        vkCmdPipelineBarrier(cmdBuffer.buf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+                             0, nullptr, 0, nullptr, (uint32_t)barriers.size(), barriers.data());
+        cmdBuffer.End();
+        cmdBuffer.Exec(m_vkQueue);
+        if (!cmdBuffer.Wait()) THROW("Offscreen image transition did not finish executing");
+
+        return bases;
+    }
+
+    // Start recording a pass that clears and draws into a swapchain image, with the cube geometry bound.
+    // Returns the ring slot whose command buffer and instance buffer the pass uses.
+    size_t BeginPass(const XrSwapchainImageBaseHeader* swapchainImage) {
         auto swapchainContext = m_swapchainImageContextMap[swapchainImage];
         uint32_t imageIndex = swapchainContext->ImageIndex(swapchainImage);
 
-        m_cmdBuffer.Reset();
-        m_cmdBuffer.Begin();
+        // Take the oldest command buffer in the ring, only waiting if the GPU has not finished with it yet.
+        const size_t slot = m_cmdBufferIndex;
+        CmdBuffer& cmdBuffer = m_cmdBuffers[slot];
+        m_cmdBufferIndex = (m_cmdBufferIndex + 1) % m_cmdBuffers.size();
+        const auto waitStart = std::chrono::steady_clock::now();
+        if (!cmdBuffer.Wait()) THROW("Command buffer did not finish executing");
+        m_passRecordStart = std::chrono::steady_clock::now();
+        m_lastPassCpuTiming.waitMs = std::chrono::duration<double, std::milli>(m_passRecordStart - waitStart).count();
+        // The slot's previous pass has finished, so collect its timestamps while the fence still says so, before the
+        // queries are reused.
+        if (m_timestampPool != VK_NULL_HANDLE) {
+            HarvestTimestamps(slot);
+        }
+        cmdBuffer.Reset();
+        cmdBuffer.Begin();
+
+        if (m_timestampPool != VK_NULL_HANDLE) {
+            vkCmdResetQueryPool(cmdBuffer.buf, m_timestampPool, 2 * (uint32_t)slot, 2);
+            vkCmdWriteTimestamp(cmdBuffer.buf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestampPool, 2 * (uint32_t)slot);
+            m_passQueries[slot] = {m_timingFrame, swapchainContext->viewMask, true};
+        }
 
         // Ensure depth is in the right layout
-        swapchainContext->depthBuffer.TransitionLayout(&m_cmdBuffer, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        swapchainContext->depthBuffer.TransitionLayout(&cmdBuffer, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
 
         // Bind and clear eye render target
         static XrColor4f darkSlateGrey = {0.184313729f, 0.309803933f, 0.309803933f, 1.0f};
@@ -1232,17 +1938,57 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
 
         swapchainContext->BindRenderTarget(imageIndex, &renderPassBeginInfo);
 
-        vkCmdBeginRenderPass(m_cmdBuffer.buf, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(cmdBuffer.buf, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-        vkCmdBindPipeline(m_cmdBuffer.buf, VK_PIPELINE_BIND_POINT_GRAPHICS, swapchainContext->pipe.pipe);
+        vkCmdBindPipeline(cmdBuffer.buf, VK_PIPELINE_BIND_POINT_GRAPHICS, swapchainContext->pipe.pipe);
 
         // Bind index and vertex buffers
-        vkCmdBindIndexBuffer(m_cmdBuffer.buf, m_drawBuffer.idxBuf, 0, VK_INDEX_TYPE_UINT16);
+        vkCmdBindIndexBuffer(cmdBuffer.buf, m_drawBuffer.idxBuf, 0, VK_INDEX_TYPE_UINT16);
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(cmdBuffer.buf, 0, 1, &m_drawBuffer.vtxBuf, &offset);
+
+        return slot;
+    }
+
+    // Write the model transform of every cube into the slot's instance buffer and draw them all with one call.
+    void DrawCubes(size_t slot, const FrameArray<Cube>& cubes) {
+        if (cubes.empty()) {
+            return;
+        }
+        CmdBuffer& cmdBuffer = m_cmdBuffers[slot];
+        InstanceBuffer<CubeInstance>& instances = m_instanceBuffers[slot];
+        instances.Reserve((uint32_t)cubes.size());
+        for (size_t i = 0; i < cubes.size(); i++) {
+            const Cube& cube = cubes[i];
+            XrMatrix4x4f_CreateTranslationRotationScale(&instances.data[i].model, &cube.Pose.position, &cube.Pose.orientation,
+                                                        &cube.Scale);
+        }
+
         VkDeviceSize offset = 0;
-        vkCmdBindVertexBuffers(m_cmdBuffer.buf, 0, 1, &m_drawBuffer.vtxBuf, &offset);
+        vkCmdBindVertexBuffers(cmdBuffer.buf, 1, 1, &instances.buf, &offset);
+        vkCmdDrawIndexed(cmdBuffer.buf, m_drawBuffer.count.idx, (uint32_t)cubes.size(), 0, 0, 0);
+    }
 
-        // Compute the view-projection transform.
-        // Note all matrixes (including OpenXR's) are column-major, right-handed.
+    // Finish and submit a pass started with BeginPass.
+    void EndPass(size_t slot) {
+        CmdBuffer& cmdBuffer = m_cmdBuffers[slot];
+        vkCmdEndRenderPass(cmdBuffer.buf);
+        if (m_timestampPool != VK_NULL_HANDLE) {
+            vkCmdWriteTimestamp(cmdBuffer.buf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampPool, 2 * (uint32_t)slot + 1);
+        }
+
+        // Submit without waiting. The runtime consumes the swapchain image on the same queue, so it sees the work in order.
+        cmdBuffer.End();
+        const auto submitStart = std::chrono::steady_clock::now();
+        cmdBuffer.Exec(m_vkQueue);
+        const auto submitEnd = std::chrono::steady_clock::now();
+        m_lastPassCpuTiming.recordMs = std::chrono::duration<double, std::milli>(submitStart - m_passRecordStart).count();
+        m_lastPassCpuTiming.submitMs = std::chrono::duration<double, std::milli>(submitEnd - submitStart).count();
+    }
+
+    // Compute the view-projection transform of a view.
+    // Note all matrixes (including OpenXR's) are column-major, right-handed.
+    static XrMatrix4x4f ViewProjection(const XrCompositionLayerProjectionView& layerView) {
         const auto& pose = layerView.pose;
         XrMatrix4x4f proj;
         XrMatrix4x4f_CreateProjectionFov(&proj, GRAPHICS_VULKAN, layerView.fov, 0.05f, 100.0f);
@@ -1253,34 +1999,111 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
         XrMatrix4x4f_InvertRigidBody(&view, &toView);
         XrMatrix4x4f vp;
         XrMatrix4x4f_Multiply(&vp, &proj, &view);
+        return vp;
+    }
+
+    void RenderView(const XrCompositionLayerProjectionView& layerView, const XrSwapchainImageBaseHeader* swapchainImage,
+                    int64_t /*swapchainFormat*/, const FrameArray<Cube>& cubes) override {
+        CHECK(layerView.subImage.imageArrayIndex == 0);  // Texture arrays not supported.
+
+        const size_t slot = BeginPass(swapchainImage);
+        CmdBuffer& cmdBuffer = m_cmdBuffers[slot];
 
-        // Render each cube
-        for (const Cube& cube : cubes) {
-            // Compute the model-view-projection transform and push it.
-            XrMatrix4x4f model;
-            XrMatrix4x4f_CreateTranslationRotationScale(&model, &cube.Pose.position, &cube.Pose.orientation, &cube.Scale);
-            XrMatrix4x4f mvp;
-            XrMatrix4x4f_Multiply(&mvp, &vp, &model);
-            vkCmdPushConstants(m_cmdBuffer.buf, m_pipelineLayout.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(mvp.m), &mvp.m[0]);
+        const XrMatrix4x4f vp = ViewProjection(layerView);
+        vkCmdPushConstants(cmdBuffer.buf, m_pipelineLayout.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(vp.m), &vp.m[0]);
+        DrawCubes(slot, cubes);
 
-            // Draw the cube.
-            vkCmdDrawIndexed(m_cmdBuffer.buf, m_drawBuffer.count.idx, 1, 0, 0, 0);
+        EndPass(slot);
+    }
+
+    bool SupportsMultiview() const override { return m_multiviewSupported; }
+
+    void RenderMultiview(const XrCompositionLayerProjectionView* layerViews, uint32_t viewCount,
+                         const XrSwapchainImageBaseHeader* swapchainImage, int64_t /*swapchainFormat*/,
+                         const FrameArray<Cube>& cubes) override {
+        CHECK(m_multiviewSupported);
+        CHECK_MSG(viewCount == 2, "Multiview push constants hold two views");
+
+        const size_t slot = BeginPass(swapchainImage);
+        CmdBuffer& cmdBuffer = m_cmdBuffers[slot];
+
+        // The shader picks the transform of the view being drawn.
+        std::array<XrMatrix4x4f, 2> vp;
+        for (uint32_t i = 0; i < viewCount; i++) {
+            CHECK(layerViews[i].subImage.imageArrayIndex == i);
+            vp[i] = ViewProjection(layerViews[i]);
         }
+        vkCmdPushConstants(cmdBuffer.buf, m_pipelineLayout.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(vp), vp.data());
+        DrawCubes(slot, cubes);
+
+        EndPass(slot);
+    }
 
-        vkCmdEndRenderPass(m_cmdBuffer.buf);
+    void BeginFrameTiming(uint64_t frame) override { m_timingFrame = frame; }
 
-        m_cmdBuffer.End();
-        m_cmdBuffer.Exec(m_vkQueue);
-        // XXX Should double-buffer the command buffers, for now just flush
-        m_cmdBuffer.Wait();
+    PassCpuTiming GetLastPassCpuTiming() const override { return m_lastPassCpuTiming; }
+
+    void WaitIdle() override {
+        if (m_vkDevice != VK_NULL_HANDLE) {
+            CHECK_VKCMD(vkDeviceWaitIdle(m_vkDevice));
+        }
+    }
+
+    size_t CollectGpuTimings(GpuPassTiming* timings, size_t capacity) override {
+        for (size_t slot = 0; slot < m_passQueries.size(); slot++) {
+            HarvestTimestamps(slot);
+        }
+        size_t count = 0;
+        while (count < capacity && m_gpuTimingCount > 0) {
+            timings[count++] = m_gpuTimings[m_gpuTimingHead];
+            m_gpuTimingHead = (m_gpuTimingHead + 1) % m_gpuTimings.size();
+            m_gpuTimingCount--;
+        }
+        return count;
+    }
+
+    // Read the slot's timestamps if its pass has executed. Never waits: results that are not ready stay pending.
+    // Availability alone is not enough: until the slot's command buffer has run, the queries it resets still hold the
+    // previous pass's timestamps, so only its fence says the results belong to this pass.
+    void HarvestTimestamps(size_t slot) {
+        PassQuery& query = m_passQueries[slot];
+        if (!query.pending || vkGetFenceStatus(m_vkDevice, m_cmdBuffers[slot].execFence) != VK_SUCCESS) {
+            return;
+        }
+        std::array<uint64_t, 4> results{};  // Timestamp and availability of each query
+        const VkResult res = vkGetQueryPoolResults(m_vkDevice, m_timestampPool, 2 * (uint32_t)slot, 2, sizeof(results),
+                                                   results.data(), 2 * sizeof(uint64_t),
+                                                   VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (res == VK_NOT_READY || results[1] == 0 || results[3] == 0) {
+            return;
+        }
+        CHECK_VKRESULT(res, "vkGetQueryPoolResults");
+        query.pending = false;
+
+        // Keep the newest timings if nobody collects them
+        const uint64_t ticks = (results[2] - results[0]) & m_timestampMask;
+        const size_t tail = (m_gpuTimingHead + m_gpuTimingCount) % m_gpuTimings.size();
+        m_gpuTimings[tail] = {query.frame, query.viewMask, double(ticks) * m_timestampPeriodNs * 1e-6};
+        if (m_gpuTimingCount < m_gpuTimings.size()) {
+            m_gpuTimingCount++;
+        } else {
+            m_gpuTimingHead = (m_gpuTimingHead + 1) % m_gpuTimings.size();
+        }
     }
 
     uint32_t GetSupportedSwapchainSampleCount(const XrViewConfigurationView&) override { return VK_SAMPLE_COUNT_1_BIT; }
 
    protected:
     XrGraphicsBindingVulkan2KHR m_graphicsBinding{XR_TYPE_GRAPHICS_BINDING_VULKAN2_KHR};
+    MemoryAllocator m_memAllocator{};  // Declared before the resources allocated from it so it is destroyed after them.
     std::list<SwapchainImageContext> m_swapchainImageContexts;
     std::map<const XrSwapchainImageBaseHeader*, SwapchainImageContext*> m_swapchainImageContextMap;
+    // Images the plugin created itself for headless rendering, in place of a runtime's swapchain images.
+    struct OffscreenImage {
+        VkImage image{VK_NULL_HANDLE};
+        MemoryAllocation memory{};
+    };
+    std::vector<OffscreenImage> m_offscreenImages;
 
     VkInstance m_vkInstance{VK_NULL_HANDLE};
     VkPhysicalDevice m_vkPhysicalDevice{VK_NULL_HANDLE};
@@ -1289,10 +2112,36 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
     VkQueue m_vkQueue{VK_NULL_HANDLE};
     VkSemaphore m_vkDrawDone{VK_NULL_HANDLE};
 
-    MemoryAllocator m_memAllocator{};
     ShaderProgram m_shaderProgram{};
-    CmdBuffer m_cmdBuffer{};
+    ShaderProgram m_multiviewShaderProgram{};
+    bool m_multiviewSupported{false};
+    bool m_physicalDeviceProperties2Enabled{false};  // VK_KHR_get_physical_device_properties2 on the instance
+    uint32_t m_cmdBufferCount;
+    std::vector<CmdBuffer> m_cmdBuffers;
+    std::vector<InstanceBuffer<CubeInstance>> m_instanceBuffers;  // One per command buffer, refilled with it.
+    size_t m_cmdBufferIndex{0};
     PipelineLayout m_pipelineLayout{};
+    std::string m_pipelineCachePath;
+    uint32_t m_singleViewSwapchains{0};
+
+    // GPU pass timing: each command buffer slot owns two timestamp queries around its render pass.
+    struct PassQuery {
+        uint64_t frame;
+        uint32_t viewMask;
+        bool pending;  // Written and not yet read back
+    };
+    bool m_timestampsSupported{false};
+    uint64_t m_timestampMask{0};
+    double m_timestampPeriodNs{0};
+    VkQueryPool m_timestampPool{VK_NULL_HANDLE};
+    std::vector<PassQuery> m_passQueries;
+    uint64_t m_timingFrame{0};
+    std::array<GpuPassTiming, 64> m_gpuTimings{};  // Harvested timings waiting for CollectGpuTimings, a ring
+    size_t m_gpuTimingHead{0};
+    size_t m_gpuTimingCount{0};
+    PassCpuTiming m_lastPassCpuTiming{};
+    std::chrono::steady_clock::time_point m_passRecordStart{};
+    PipelineCache m_pipelineCache{};  // Shared by every swapchain's pipeline, saved when the plugin is destroyed.
     VertexBuffer<Geometry::Vertex> m_drawBuffer{};
 
     PFN_vkCreateDebugReportCallbackEXT vkCreateDebugReportCallbackEXT{nullptr};
@@ -7,9 +7,15 @@
 #include "options.h"
 #include "platformplugin.h"
 #include "graphicsplugin.h"
+#include "frame_layer.h"
 #include "openxr_program.h"
 #include "xr_linear.h"
+#include "xr_clock.h"
+#include "seqlock.hpp"
+#include "sample_signal.hpp"
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 
 namespace {
@@ -118,6 +124,18 @@ struct OpenXrProgram : IOpenXrProgram {
         : m_options(options), m_platformPlugin(platformPlugin), m_graphicsPlugin(graphicsPlugin) {}
 
     ~OpenXrProgram() override {
+        // The tracking thread locates the hand spaces, so it has to stop before they are destroyed.
+        stopTracking();
+
+        // Let the last passes finish so their GPU times make it into the summary.
+        if (m_graphicsPlugin != nullptr) {
+            m_graphicsPlugin->WaitIdle();
+            ::CollectGpuTimings(*m_graphicsPlugin, m_frameTimings);
+        }
+        if (!m_frameTimings.empty()) {
+            Log::Write(Log::Level::Info, Fmt("Frame pacing over the last %s", m_frameTimings.summarize().describe().c_str()));
+        }
+
         if (m_input.actionSet != XR_NULL_HANDLE) {
             for (auto hand : {Side::LEFT, Side::RIGHT}) {
                 xrDestroySpace(m_input.handSpace[hand]);
@@ -213,9 +231,38 @@ struct OpenXrProgram : IOpenXrProgram {
         const std::vector<std::string> platformExtensions = m_platformPlugin->GetInstanceExtensions();
         std::transform(platformExtensions.begin(), platformExtensions.end(), std::back_inserter(extensions),
                        [](const std::string& ext) { return ext.c_str(); });
-        const std::vector<std::string> graphicsExtensions = m_graphicsPlugin->GetInstanceExtensions();
-        std::transform(graphicsExtensions.begin(), graphicsExtensions.end(), std::back_inserter(extensions),
-                       [](const std::string& ext) { return ext.c_str(); });
+
+        // Map XrTime onto CLOCK_MONOTONIC when the runtime can convert between them.
+        const bool convertTimespec = IsInstanceExtensionSupported(XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME);
+        if (convertTimespec) {
+            extensions.push_back(XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME);
+        }
+
+        // A headless session never waits on frames, so XrTime has to come from the runtime's clock conversion.
+        if (m_options->Headless) {
+            CHECK(m_options->HeadlessFrameRate > 0);
+            m_headless = convertTimespec && IsInstanceExtensionSupported(XR_MND_HEADLESS_EXTENSION_NAME);
+            if (!m_headless) {
+                Log::Write(Log::Level::Warning,
+                           "Headless session needs XR_MND_headless and XR_KHR_convert_timespec_time, rendering instead");
+            }
+        }
+        std::vector<std::string> graphicsExtensions;
+        if (m_headless) {
+            extensions.push_back(XR_MND_HEADLESS_EXTENSION_NAME);
+        } else {
+            graphicsExtensions = m_graphicsPlugin->GetInstanceExtensions();
+            std::transform(graphicsExtensions.begin(), graphicsExtensions.end(), std::back_inserter(extensions),
+                           [](const std::string& ext) { return ext.c_str(); });
+        }
+
+#ifdef XR_KHR_locate_spaces
+        // Locate all of a frame's spaces in one call when the runtime supports it.
+        const bool locateSpaces = IsInstanceExtensionSupported(XR_KHR_LOCATE_SPACES_EXTENSION_NAME);
+        if (locateSpaces) {
+            extensions.push_back(XR_KHR_LOCATE_SPACES_EXTENSION_NAME);
+        }
+#endif
 
         XrInstanceCreateInfo createInfo{XR_TYPE_INSTANCE_CREATE_INFO};
         createInfo.next = m_platformPlugin->GetInstanceCreateExtension();
@@ -226,6 +273,27 @@ struct OpenXrProgram : IOpenXrProgram {
         createInfo.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
 
         CHECK_XRCMD(xrCreateInstance(&createInfo, &m_instance));
+
+        m_clock.initialize(m_instance, convertTimespec);
+        CHECK_MSG(!m_headless || m_clock.usesRuntimeConversion(), "Headless session cannot convert XrTime");
+
+#ifdef XR_KHR_locate_spaces
+        if (locateSpaces) {
+            CHECK_XRCMD(xrGetInstanceProcAddr(m_instance, "xrLocateSpacesKHR", reinterpret_cast<PFN_xrVoidFunction*>(&m_locateSpaces)));
+        }
+        Log::Write(Log::Level::Info, locateSpaces ? "Locating spaces with xrLocateSpacesKHR" : "Locating spaces one at a time");
+#endif
+    }
+
+    static bool IsInstanceExtensionSupported(const char* extensionName) {
+        uint32_t instanceExtensionCount;
+        CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(nullptr, 0, &instanceExtensionCount, nullptr));
+        std::vector<XrExtensionProperties> extensions(instanceExtensionCount, {XR_TYPE_EXTENSION_PROPERTIES});
+        CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(nullptr, (uint32_t)extensions.size(), &instanceExtensionCount,
+                                                           extensions.data()));
+        return std::any_of(extensions.begin(), extensions.end(), [&](const XrExtensionProperties& extension) {
+            return strcmp(extension.extensionName, extensionName) == 0;
+        });
     }
 
     void CreateInstance() override {
@@ -322,6 +390,11 @@ struct OpenXrProgram : IOpenXrProgram {
         CHECK(m_instance != XR_NULL_HANDLE);
         CHECK(m_systemId != XR_NULL_SYSTEM_ID);
 
+        if (m_headless) {
+            Log::Write(Log::Level::Info, "Headless session, skipping views and graphics device");
+            return;
+        }
+
         LogViewConfigurations();
 
         // The graphics API can initialize the graphics device now that the systemId and instance
@@ -577,7 +650,8 @@ struct OpenXrProgram : IOpenXrProgram {
             Log::Write(Log::Level::Verbose, Fmt("Creating session..."));
 
             XrSessionCreateInfo createInfo{XR_TYPE_SESSION_CREATE_INFO};
-            createInfo.next = m_graphicsPlugin->GetGraphicsBinding();
+            // XR_MND_headless sessions are created without a graphics binding.
+            createInfo.next = m_headless ? nullptr : m_graphicsPlugin->GetGraphicsBinding();
             createInfo.systemId = m_systemId;
             CHECK_XRCMD(xrCreateSession(m_instance, &createInfo, &m_session));
         }
@@ -590,6 +664,18 @@ struct OpenXrProgram : IOpenXrProgram {
             XrReferenceSpaceCreateInfo referenceSpaceCreateInfo = GetXrReferenceSpaceCreateInfo(m_options->AppSpace);
             CHECK_XRCMD(xrCreateReferenceSpace(m_session, &referenceSpaceCreateInfo, &m_appSpace));
         }
+
+        // Spaces located once per display time: the visualized spaces followed by the hands.
+        m_spaceCache.spaces = m_visualizedSpaces;
+        m_spaceCache.handOffset = m_spaceCache.spaces.size();
+        m_spaceCache.spaces.insert(m_spaceCache.spaces.end(), m_input.handSpace.begin(), m_input.handSpace.end());
+        m_spaceCache.states.resize(m_spaceCache.spaces.size());
+        m_spaceCache.results.resize(m_spaceCache.spaces.size());
+        m_locateFailures.Reset(m_spaceCache.spaces.size());
+#ifdef XR_KHR_locate_spaces
+        m_spaceCache.locationData.resize(m_spaceCache.spaces.size());
+        m_spaceCache.velocityData.resize(m_spaceCache.spaces.size());
+#endif
     }
 
     void CreateSwapchains() override {
@@ -597,6 +683,10 @@ struct OpenXrProgram : IOpenXrProgram {
         CHECK(m_swapchains.empty());
         CHECK(m_configViews.empty());
 
+        if (m_headless) {
+            return;  // Nothing is rendered.
+        }
+
         // Read graphics properties for preferred swapchain length and logging.
         XrSystemProperties systemProperties{XR_TYPE_SYSTEM_PROPERTIES};
         CHECK_XRCMD(xrGetSystemProperties(m_instance, m_systemId, &systemProperties));
@@ -655,8 +745,16 @@ struct OpenXrProgram : IOpenXrProgram {
                 Log::Write(Log::Level::Verbose, Fmt("Swapchain Formats: %s", swapchainFormatsString.c_str()));
             }
 
-            // Create a swapchain for each view.
-            for (uint32_t i = 0; i < viewCount; i++) {
+            // Render both views in one pass into a single array swapchain when the views match and the plugin can.
+            m_multiview = m_options->Multiview && m_graphicsPlugin->SupportsMultiview() && viewCount == 2 &&
+                          m_configViews[0].recommendedImageRectWidth == m_configViews[1].recommendedImageRectWidth &&
+                          m_configViews[0].recommendedImageRectHeight == m_configViews[1].recommendedImageRectHeight &&
+                          m_configViews[0].recommendedSwapchainSampleCount == m_configViews[1].recommendedSwapchainSampleCount;
+            Log::Write(Log::Level::Info, Fmt("Rendering views %s", m_multiview ? "in one multiview pass" : "one pass per view"));
+
+            // Create a swapchain for each view, or one with a layer per view.
+            const uint32_t swapchainCount = m_multiview ? 1 : viewCount;
+            for (uint32_t i = 0; i < swapchainCount; i++) {
                 const XrViewConfigurationView& vp = m_configViews[i];
                 Log::Write(Log::Level::Info,
                            Fmt("Creating swapchain for view %d with dimensions Width=%d Height=%d SampleCount=%d", i,
@@ -664,7 +762,7 @@ struct OpenXrProgram : IOpenXrProgram {
 
                 // Create the swapchain.
                 XrSwapchainCreateInfo swapchainCreateInfo{XR_TYPE_SWAPCHAIN_CREATE_INFO};
-                swapchainCreateInfo.arraySize = 1;
+                swapchainCreateInfo.arraySize = m_multiview ? viewCount : 1;
                 swapchainCreateInfo.format = m_colorSwapchainFormat;
                 swapchainCreateInfo.width = vp.recommendedImageRectWidth;
                 swapchainCreateInfo.height = vp.recommendedImageRectHeight;
@@ -883,44 +981,228 @@ struct OpenXrProgram : IOpenXrProgram {
     XrTime RenderFrame() override {
         CHECK(m_session != XR_NULL_HANDLE);
 
+        const int64_t previousDisplayTime = m_frameTimings.empty() ? 0 : m_frameTimings[m_frameTimings.size() - 1].displayTime;
+        FrameTiming& timing = m_frameTimings.push();
+        if (m_headless) {
+            return PaceHeadlessFrame(timing, previousDisplayTime);
+        }
+
         XrFrameWaitInfo frameWaitInfo{XR_TYPE_FRAME_WAIT_INFO};
         XrFrameState frameState{XR_TYPE_FRAME_STATE};
+        auto start = std::chrono::steady_clock::now();
         CHECK_XRCMD(xrWaitFrame(m_session, &frameWaitInfo, &frameState));
+        timing.waitMs = ElapsedMs(start);
+        timing.displayTime = frameState.predictedDisplayTime;
+        timing.displayPeriodMs = frameState.predictedDisplayPeriod * 1e-6;
+        timing.missedPeriods = FrameTiming::countMissedPeriods(previousDisplayTime, frameState.predictedDisplayTime,
+                                                               frameState.predictedDisplayPeriod);
+
+        // Keep the XrTime mapping current. Without runtime conversion xrWaitFrame is assumed to return about one display
+        // period before the frame it predicts is shown.
+        m_clock.update(frameState.predictedDisplayTime - frameState.predictedDisplayPeriod);
 
         XrFrameBeginInfo frameBeginInfo{XR_TYPE_FRAME_BEGIN_INFO};
+        start = std::chrono::steady_clock::now();
         CHECK_XRCMD(xrBeginFrame(m_session, &frameBeginInfo));
+        timing.beginMs = ElapsedMs(start);
 
-        std::vector<XrCompositionLayerBaseHeader*> layers;
-        XrCompositionLayerProjection layer{XR_TYPE_COMPOSITION_LAYER_PROJECTION};
-        std::vector<XrCompositionLayerProjectionView> projectionLayerViews;
+        // Per-frame temporaries come from the frame arena so the render thread does not allocate.
+        FrameLayer frameLayer(m_frameArena, m_views.size(), m_visualizedSpaces.size() + Side::COUNT);
+        m_graphicsPlugin->BeginFrameTiming(timing.frame);
         if (frameState.shouldRender == XR_TRUE) {
-            if (RenderLayer(frameState.predictedDisplayTime, projectionLayerViews, layer)) {
-                layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader*>(&layer));
+            start = std::chrono::steady_clock::now();
+            if (RenderLayer(frameState.predictedDisplayTime, frameLayer)) {
+                frameLayer.Submit(m_appSpace);
             }
+            timing.renderCpuMs = ElapsedMs(start);
         }
+        ::CollectGpuTimings(*m_graphicsPlugin, m_frameTimings);
 
         XrFrameEndInfo frameEndInfo{XR_TYPE_FRAME_END_INFO};
         frameEndInfo.displayTime = frameState.predictedDisplayTime;
         frameEndInfo.environmentBlendMode = m_environmentBlendMode;
-        frameEndInfo.layerCount = (uint32_t)layers.size();
-        frameEndInfo.layers = layers.data();
+        frameEndInfo.layerCount = (uint32_t)frameLayer.layers.size();
+        frameEndInfo.layers = frameLayer.layers.data();
+        start = std::chrono::steady_clock::now();
         CHECK_XRCMD(xrEndFrame(m_session, &frameEndInfo));
+        timing.endMs = ElapsedMs(start);
+        m_frameArena.reset();
 
+        // Late frames are only counted, in the session totals of the pacing summary: formatting a message here would
+        // allocate on exactly the frames that are already behind.
         return frameState.predictedDisplayTime;
     }
 
+    // A headless session has no frame loop to block in, so wait out the rest of the frame period instead and return the
+    // current time, at which the application locates the controllers.
+    XrTime PaceHeadlessFrame(FrameTiming& timing, int64_t previousDisplayTime) {
+        const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / m_options->HeadlessFrameRate));
+        m_headlessNextFrame += period;
+        const auto now = std::chrono::steady_clock::now();
+        if (m_headlessNextFrame < now) {
+            m_headlessNextFrame = now;  // Fell behind, skip the missed frames.
+        } else {
+            std::this_thread::sleep_until(m_headlessNextFrame);
+        }
+        timing.waitMs = ElapsedMs(now);
+        m_clock.update(0);
+
+        const XrTime time = m_clock.now();
+        const XrDuration periodNs = std::chrono::duration_cast<std::chrono::nanoseconds>(period).count();
+        timing.displayTime = time;
+        timing.displayPeriodMs = periodNs * 1e-6;
+        timing.missedPeriods = FrameTiming::countMissedPeriods(previousDisplayTime, time, periodNs);
+        return time;
+    }
+
+    static double ElapsedMs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool isHeadless() const override { return m_headless; }
+
     XrSpaceLocation getControllerSpace(XrTime predictedDisplayTime,int hand) override {
-        // auto hand = Side::RIGHT;
-        // auto hand = hand;
-        XrSpaceVelocity spaceVelocity {XR_TYPE_SPACE_VELOCITY};
-        XrSpaceLocation spaceLocation{XR_TYPE_SPACE_LOCATION, &spaceVelocity};
-        XrResult res = xrLocateSpace(m_input.handSpace[hand], m_appSpace, predictedDisplayTime, &spaceLocation);
-        
-        return spaceLocation;
+        return getControllerState(predictedDisplayTime, hand).location;
+    }
+
+    const FrameTimingHistory& getFrameTimings() const override { return m_frameTimings; }
+
+    FramePacingSummary getFramePacingSummary() const override { return m_frameTimings.summarize(); }
+
+    ControllerState getControllerState(XrTime predictedDisplayTime, int hand) override {
+        LocateSpaces(predictedDisplayTime);
+        return m_spaceCache.states[m_spaceCache.handOffset + hand];
     }
 
-    bool RenderLayer(XrTime predictedDisplayTime, std::vector<XrCompositionLayerProjectionView>& projectionLayerViews,
-                     XrCompositionLayerProjection& layer) {
+    // Locate a single space in app space, with its velocity. Safe to call from any thread.
+    ControllerState LocateSpace(XrSpace space, XrTime time, XrResult* result) const {
+        ControllerState state{{XR_TYPE_SPACE_LOCATION}, {XR_TYPE_SPACE_VELOCITY}};
+        state.location.next = &state.velocity;
+        *result = xrLocateSpace(space, m_appSpace, time, &state.location);
+
+        // Don't hand out a pointer into this stack frame.
+        state.location.next = nullptr;
+        if (XR_FAILED(*result)) {
+            state.location.locationFlags = 0;
+            state.velocity.velocityFlags = 0;
+        }
+        return state;
+    }
+
+    // Locate every cached space at time, unless they were already located at that time. Frame thread only.
+    // A space that fails to locate is cached with its valid bits cleared and its result kept, rather than throwing: a
+    // momentary tracking loss must not end the loop.
+    void LocateSpaces(XrTime time) {
+        if (m_spaceCache.time == time) {
+            return;
+        }
+        m_spaceCache.time = time;
+
+#ifdef XR_KHR_locate_spaces
+        if (m_locateSpaces != nullptr) {
+            const uint32_t spaceCount = (uint32_t)m_spaceCache.spaces.size();
+            XrSpacesLocateInfoKHR locateInfo{XR_TYPE_SPACES_LOCATE_INFO_KHR};
+            locateInfo.baseSpace = m_appSpace;
+            locateInfo.time = time;
+            locateInfo.spaceCount = spaceCount;
+            locateInfo.spaces = m_spaceCache.spaces.data();
+
+            XrSpaceVelocitiesKHR velocities{XR_TYPE_SPACE_VELOCITIES_KHR};
+            velocities.velocityCount = spaceCount;
+            velocities.velocities = m_spaceCache.velocityData.data();
+
+            XrSpaceLocationsKHR locations{XR_TYPE_SPACE_LOCATIONS_KHR};
+            locations.next = &velocities;
+            locations.locationCount = spaceCount;
+            locations.locations = m_spaceCache.locationData.data();
+
+            const XrResult res = m_locateSpaces(m_session, &locateInfo, &locations);
+            for (uint32_t i = 0; i < spaceCount; i++) {
+                ControllerState& state = m_spaceCache.states[i];
+                state = {{XR_TYPE_SPACE_LOCATION}, {XR_TYPE_SPACE_VELOCITY}};
+                m_spaceCache.results[i] = res;
+                if (XR_FAILED(res)) {
+                    continue;
+                }
+                state.location.locationFlags = m_spaceCache.locationData[i].locationFlags;
+                state.location.pose = m_spaceCache.locationData[i].pose;
+                state.velocity.velocityFlags = m_spaceCache.velocityData[i].velocityFlags;
+                state.velocity.linearVelocity = m_spaceCache.velocityData[i].linearVelocity;
+                state.velocity.angularVelocity = m_spaceCache.velocityData[i].angularVelocity;
+            }
+            return;
+        }
+#endif
+
+        for (size_t i = 0; i < m_spaceCache.spaces.size(); i++) {
+            m_spaceCache.states[i] = LocateSpace(m_spaceCache.spaces[i], time, &m_spaceCache.results[i]);
+        }
+    }
+
+    void startTracking(double rateHz) override {
+        CHECK(m_session != XR_NULL_HANDLE);
+        CHECK(rateHz > 0);
+
+        stopTracking();
+        m_trackingRunning = true;
+        m_trackingThread = std::thread(&OpenXrProgram::TrackingLoop, this, rateHz);
+        Log::Write(Log::Level::Info, Fmt("Tracking controllers at %.0f Hz", rateHz));
+    }
+
+    void stopTracking() override {
+        m_trackingRunning = false;
+        m_trackingSignal.notify();
+        if (m_trackingThread.joinable()) {
+            m_trackingThread.join();
+        }
+    }
+
+    TrackedControllerState getTrackedControllerState(int hand) const override {
+        TrackedControllerState tracked{};
+        m_trackedControllers[hand].load(tracked);
+        return tracked;
+    }
+
+    TrackedControllerState waitTrackedControllerState(int hand, uint64_t sample, std::chrono::microseconds timeout) override {
+        m_trackingSignal.wait(timeout, [&]() { return m_trackedControllers[hand].getVersion() != sample || !m_trackingRunning; });
+        return getTrackedControllerState(hand);
+    }
+
+    double toSteadyTime(XrTime time) const override { return m_clock.toSteadyTime(time); }
+
+    XrTime toXrTime(double steadyTime) const override { return m_clock.toXrTime(steadyTime); }
+
+    // Locate both controllers at the estimated current time every period, without waiting on the frame loop.
+    void TrackingLoop(double rateHz) {
+        const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rateHz));
+        auto next = std::chrono::steady_clock::now();
+
+        while (m_trackingRunning) {
+            if (m_sessionRunning && m_clock.isCalibrated()) {
+                const XrTime now = m_clock.now();
+                for (auto hand : {Side::LEFT, Side::RIGHT}) {
+                    // Locate directly, the frame's location cache belongs to the frame thread.
+                    XrResult res;
+                    TrackedControllerState tracked{LocateSpace(m_input.handSpace[hand], now, &res), now,
+                                                   m_trackedControllers[hand].getVersion() + 1};
+                    m_trackedControllers[hand].store(tracked);
+                }
+                m_trackingSignal.notify();
+            }
+
+            // Skip missed periods rather than catching up with a burst of samples.
+            next += period;
+            const auto wake = std::chrono::steady_clock::now();
+            if (next < wake) {
+                next = wake;
+            }
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    // Render the views of frameLayer, false if they could not be located. RenderFrame submits the layer.
+    bool RenderLayer(XrTime predictedDisplayTime, FrameLayer& frameLayer) {
         XrResult res;
 
         XrViewState viewState{XR_TYPE_VIEW_STATE};
@@ -941,52 +1223,72 @@ struct OpenXrProgram : IOpenXrProgram {
 
         CHECK(viewCountOutput == viewCapacityInput);
         CHECK(viewCountOutput == m_configViews.size());
-        CHECK(viewCountOutput == m_swapchains.size());
+        CHECK(m_multiview ? m_swapchains.size() == 1 : viewCountOutput == m_swapchains.size());
 
+        FrameArray<XrCompositionLayerProjectionView>& projectionLayerViews = frameLayer.projectionViews;
+        const FrameArray<Cube>& cubes = frameLayer.cubes;
         projectionLayerViews.resize(viewCountOutput);
 
-        // For each locatable space that we want to visualize, render a 25cm cube.
-        std::vector<Cube> cubes;
+        // Locate every space for this display time at once, getControllerState reuses the result.
+        LocateSpaces(predictedDisplayTime);
 
-        for (XrSpace visualizedSpace : m_visualizedSpaces) {
-            XrSpaceLocation spaceLocation{XR_TYPE_SPACE_LOCATION};
-            res = xrLocateSpace(visualizedSpace, m_appSpace, predictedDisplayTime, &spaceLocation);
-            CHECK_XRRESULT(res, "xrLocateSpace");
+        // For each locatable space that we want to visualize, render a 25cm cube.
+        for (size_t i = 0; i < m_visualizedSpaces.size(); i++) {
+            res = m_spaceCache.results[i];
+            m_locateFailures.Record(i, res, "a visualized reference space");
             if (XR_UNQUALIFIED_SUCCESS(res)) {
-                if ((spaceLocation.locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) != 0 &&
-                    (spaceLocation.locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT) != 0) {
-                    cubes.push_back(Cube{spaceLocation.pose, {0.25f, 0.25f, 0.25f}});
-                }
-            } else {
-                Log::Write(Log::Level::Verbose, Fmt("Unable to locate a visualized reference space in app space: %d", res));
+                frameLayer.AddCube(m_spaceCache.states[i].location, {0.25f, 0.25f, 0.25f});
             }
         }
 
         // Render a 10cm cube scaled by grabAction for each hand. Note renderHand will only be
         // true when the application has focus.
         for (auto hand : {Side::LEFT, Side::RIGHT}) {
-            XrSpaceLocation spaceLocation{XR_TYPE_SPACE_LOCATION};
-            res = xrLocateSpace(m_input.handSpace[hand], m_appSpace, predictedDisplayTime, &spaceLocation);
-            CHECK_XRRESULT(res, "xrLocateSpace");
+            const size_t index = m_spaceCache.handOffset + hand;
+            res = m_spaceCache.results[index];
+            // Tracking loss is expected when the hand is not active so only log a message
+            // if the hand is active.
+            const char* handName[] = {"left hand action space", "right hand action space"};
+            m_locateFailures.Record(index, m_input.handActive[hand] == XR_TRUE ? res : XR_SUCCESS, handName[hand]);
             if (XR_UNQUALIFIED_SUCCESS(res)) {
-                if ((spaceLocation.locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) != 0 &&
-                    (spaceLocation.locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT) != 0) {
-                    float scale = 0.1f * m_input.handScale[hand];
-                    cubes.push_back(Cube{spaceLocation.pose, {scale, scale, scale}});
-                }
-            } else {
-                // Tracking loss is expected when the hand is not active so only log a message
-                // if the hand is active.
-                if (m_input.handActive[hand] == XR_TRUE) {
-                    const char* handName[] = {"left", "right"};
-                    Log::Write(Log::Level::Verbose,
-                               Fmt("Unable to locate %s hand action space in app space: %d", handName[hand], res));
-                }
+                const float scale = 0.1f * m_input.handScale[hand];
+                frameLayer.AddCube(m_spaceCache.states[index].location, {scale, scale, scale});
             }
         }
 
+        if (m_multiview) {
+            // Both views share one swapchain, view i in array layer i, and are drawn in a single pass.
+            const Swapchain swapchain = m_swapchains[0];
+
+            XrSwapchainImageAcquireInfo acquireInfo{XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
+
+            uint32_t swapchainImageIndex;
+            CHECK_XRCMD(xrAcquireSwapchainImage(swapchain.handle, &acquireInfo, &swapchainImageIndex));
+
+            XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+            waitInfo.timeout = XR_INFINITE_DURATION;
+            CHECK_XRCMD(xrWaitSwapchainImage(swapchain.handle, &waitInfo));
+
+            for (uint32_t i = 0; i < viewCountOutput; i++) {
+                projectionLayerViews[i] = {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW};
+                projectionLayerViews[i].pose = m_views[i].pose;
+                projectionLayerViews[i].fov = m_views[i].fov;
+                projectionLayerViews[i].subImage.swapchain = swapchain.handle;
+                projectionLayerViews[i].subImage.imageRect.offset = {0, 0};
+                projectionLayerViews[i].subImage.imageRect.extent = {swapchain.width, swapchain.height};
+                projectionLayerViews[i].subImage.imageArrayIndex = i;
+            }
+
+            const XrSwapchainImageBaseHeader* const swapchainImage = m_swapchainImages[swapchain.handle][swapchainImageIndex];
+            m_graphicsPlugin->RenderMultiview(projectionLayerViews.data(), viewCountOutput, swapchainImage,
+                                              m_colorSwapchainFormat, cubes);
+
+            XrSwapchainImageReleaseInfo releaseInfo{XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
+            CHECK_XRCMD(xrReleaseSwapchainImage(swapchain.handle, &releaseInfo));
+        }
+
         // Render view to the appropriate part of the swapchain image.
-        for (uint32_t i = 0; i < viewCountOutput; i++) {
+        for (uint32_t i = 0; i < viewCountOutput && !m_multiview; i++) {
             // Each view has a separate swapchain which is acquired, rendered to, and released.
             const Swapchain viewSwapchain = m_swapchains[i];
 
@@ -1013,9 +1315,6 @@ struct OpenXrProgram : IOpenXrProgram {
             CHECK_XRCMD(xrReleaseSwapchainImage(viewSwapchain.handle, &releaseInfo));
         }
 
-        layer.space = m_appSpace;
-        layer.viewCount = (uint32_t)projectionLayerViews.size();
-        layer.views = projectionLayerViews.data();
         return true;
     }
 
@@ -1033,6 +1332,9 @@ struct OpenXrProgram : IOpenXrProgram {
 
     std::vector<XrViewConfigurationView> m_configViews;
     std::vector<Swapchain> m_swapchains;
+    bool m_multiview{false};  // One array swapchain holds every view, see CreateSwapchains.
+    bool m_headless{false};   // Session created through XR_MND_headless: no graphics, swapchains or frame loop.
+    std::chrono::steady_clock::time_point m_headlessNextFrame{};
     std::map<XrSwapchain, std::vector<XrSwapchainImageBaseHeader*>> m_swapchainImages;
     std::vector<XrView> m_views;
     int64_t m_colorSwapchainFormat{-1};
@@ -1041,10 +1343,39 @@ struct OpenXrProgram : IOpenXrProgram {
 
     // Application's current lifecycle state according to the runtime
     XrSessionState m_sessionState{XR_SESSION_STATE_UNKNOWN};
-    bool m_sessionRunning{false};
+    std::atomic<bool> m_sessionRunning{false};
 
     XrEventDataBuffer m_eventDataBuffer;
     InputState m_input;
+    XrClock m_clock;
+
+    FrameTimingHistory m_frameTimings;
+
+    // Backs the layer, view and cube arrays of one frame; reset after xrEndFrame.
+    FrameArena m_frameArena{16 * 1024};
+
+    // Locations of every space a frame needs, located once per display time.
+    struct SpaceLocationCache {
+        XrTime time{0};
+        std::vector<XrSpace> spaces;  // Visualized spaces followed by the hand spaces.
+        size_t handOffset{0};         // Index of the left hand space.
+        std::vector<ControllerState> states;
+        std::vector<XrResult> results;
+#ifdef XR_KHR_locate_spaces
+        std::vector<XrSpaceLocationDataKHR> locationData;
+        std::vector<XrSpaceVelocityDataKHR> velocityData;
+#endif
+    };
+    SpaceLocationCache m_spaceCache;
+    LocateFailureLog m_locateFailures;  // Indexed like m_spaceCache.spaces.
+#ifdef XR_KHR_locate_spaces
+    PFN_xrLocateSpacesKHR m_locateSpaces{nullptr};
+#endif
+
+    std::thread m_trackingThread;
+    std::atomic<bool> m_trackingRunning{false};
+    std::array<Seqlock<TrackedControllerState>, Side::COUNT> m_trackedControllers;
+    SampleSignal m_trackingSignal;  // Wakes waitTrackedControllerState after each pair of samples.
 };
 }  // namespace
 
@@ -0,0 +1,447 @@
+#include "pch.h"
+#include "common.h"
+#include "logger.h"
+#include "check.h"
+#include "options.h"
+#include "platformplugin.h"
+#include "graphicsplugin.h"
+#include "frame_layer.h"
+#include "openxr_program.h"
+#include "xr_linear.h"
+#include "seqlock.hpp"
+#include "sample_signal.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// XrTime of the first replayed frame. Any positive value works, a round one makes logs easy to read.
+constexpr XrTime ReplayStartTime = 1000000000;
+
+// Offscreen images of a rendered replay: per eye size, and images cycled through as a runtime's swapchain would.
+constexpr int32_t ReplayViewWidth = 720;
+constexpr int32_t ReplayViewHeight = 800;
+constexpr uint32_t ReplayImageCount = 3;
+
+struct PoseSample {
+    double time;  // Seconds from the start of the replay.
+    XrPosef pose;
+};
+
+XrPosef PoseAt(float x, float y, float z) {
+    XrPosef pose{};
+    pose.orientation.w = 1;
+    pose.position = {x, y, z};
+    return pose;
+}
+
+// A controller held upright as drumkit expects, 90 degrees about x so its z axis points down: moving it down moves the
+// drumstick tip down through the drum heads.
+XrPosef UprightPoseAt(float x, float y, float z) {
+    XrPosef pose = PoseAt(x, y, z);
+    pose.orientation = {0.70710678f, 0, 0, 0.70710678f};
+    return pose;
+}
+
+// Read a pose recording, see Options::ReplayFile for the formats. Times are rebased to start at 0.
+bool ReadPoseFile(const std::string& filename, std::array<std::vector<PoseSample>, Side::COUNT>& samples) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string line;
+    std::getline(file, line);  // Header
+    double firstTime = NAN;
+    while (std::getline(file, line)) {
+        std::stringstream row(line);
+        std::vector<double> values;
+        std::string value;
+        try {
+            while (std::getline(row, value, ',')) {
+                values.push_back(std::stod(value));
+            }
+        } catch (const std::exception&) {
+            continue;
+        }
+
+        int hand;
+        XrPosef pose;
+        if (values.size() == 2) {
+            // Height recordings only hold the right controller's vertical position.
+            hand = Side::RIGHT;
+            pose = UprightPoseAt(0, (float)values[1], 0);
+        } else if (values.size() == 9) {
+            hand = (int)values[1];
+            if (hand != Side::LEFT && hand != Side::RIGHT) {
+                continue;
+            }
+            pose = PoseAt((float)values[2], (float)values[3], (float)values[4]);
+            pose.orientation = {(float)values[5], (float)values[6], (float)values[7], (float)values[8]};
+        } else {
+            continue;
+        }
+
+        if (std::isnan(firstTime)) {
+            firstTime = values[0];
+        }
+        const double time = values[0] - firstTime;
+        std::vector<PoseSample>& handSamples = samples[hand];
+        if (!handSamples.empty() && time <= handSamples.back().time) {
+            continue;
+        }
+        handSamples.push_back({time, pose});
+    }
+    return !samples[Side::LEFT].empty() || !samples[Side::RIGHT].empty();
+}
+
+// Both hands held upright in front of the user, the right one striking 20 cm from top to bottom at 1.5 Hz, starting at
+// the top.
+void ScriptTrajectory(double duration, double rateHz, std::array<std::vector<PoseSample>, Side::COUNT>& samples) {
+    const size_t count = (size_t)std::ceil(duration * rateHz) + 1;
+    for (size_t i = 0; i < count; i++) {
+        const double time = i / rateHz;
+        const float strike = 0.1f * (float)std::cos(2 * M_PI * 1.5 * time);
+        samples[Side::LEFT].push_back({time, UprightPoseAt(-0.2f, 1.0f, -0.3f)});
+        samples[Side::RIGHT].push_back({time, UprightPoseAt(0.2f, 1.0f + strike, -0.3f)});
+    }
+}
+
+// Stand-in for OpenXrProgram without a runtime: replays controller poses and steps XrTime by exactly one frame period
+// per RenderFrame, so every run sees the same poses at the same times. The session runs from the first PollEvents until
+// the poses run out. Given a graphics plugin, each frame draws the controllers into offscreen images from a fixed head
+// pose, through the same FrameLayer and plugin calls as OpenXrProgram.
+struct ReplayProgram : IOpenXrProgram {
+    ReplayProgram(const std::shared_ptr<Options>& options, const std::shared_ptr<IGraphicsPlugin>& graphicsPlugin)
+        : m_options(options), m_graphicsPlugin(graphicsPlugin) {}
+
+    ~ReplayProgram() override {
+        stopTracking();
+        if (m_graphicsPlugin != nullptr && m_graphicsInitialized) {
+            m_graphicsPlugin->WaitIdle();
+            CollectGpuTimings(*m_graphicsPlugin, m_frameTimings);
+        }
+        if (!m_frameTimings.empty()) {
+            Log::Write(Log::Level::Info, Fmt("Frame pacing over the last %s", m_frameTimings.summarize().describe().c_str()));
+        }
+    }
+
+    void CreateInstance() override {}
+
+    void InitializeSystem() override {
+        if (m_graphicsPlugin != nullptr) {
+            m_graphicsPlugin->InitializeHeadlessDevice();
+            m_graphicsInitialized = true;
+            m_multiview = m_options->Multiview && m_graphicsPlugin->SupportsMultiview();
+        }
+    }
+
+    void InitializeSession() override {
+        CHECK(m_options->ReplayFrameRate > 0);
+        m_framePeriod = XrDuration(1e9 / m_options->ReplayFrameRate);
+        if (m_options->ReplayFile.empty()) {
+            ScriptTrajectory(m_options->ReplayDuration, 1000, m_samples);
+            Log::Write(Log::Level::Info, Fmt("Replaying a scripted trajectory for %.1f s", m_options->ReplayDuration));
+        } else {
+            CHECK_MSG(ReadPoseFile(m_options->ReplayFile, m_samples), Fmt("No poses read from %s", m_options->ReplayFile.c_str()));
+            Log::Write(Log::Level::Info, Fmt("Replaying %d left and %d right controller poses from %s",
+                                             (int)m_samples[Side::LEFT].size(), (int)m_samples[Side::RIGHT].size(),
+                                             m_options->ReplayFile.c_str()));
+        }
+
+        m_duration = 0;
+        for (const std::vector<PoseSample>& handSamples : m_samples) {
+            if (!handSamples.empty()) {
+                m_duration = std::max(m_duration, handSamples.back().time);
+            }
+        }
+        m_sessionState = XR_SESSION_STATE_IDLE;
+    }
+
+    // Offscreen images in place of swapchains: one array image holding both eyes with multiview, otherwise one image per
+    // eye. The eyes are 64 mm apart with a 90 degree field of view, at standing height looking down -z.
+    void CreateSwapchains() override {
+        if (m_graphicsPlugin == nullptr) {
+            return;
+        }
+
+        m_colorSwapchainFormat = m_graphicsPlugin->SelectColorSwapchainFormat({VK_FORMAT_R8G8B8A8_SRGB});
+        XrSwapchainCreateInfo swapchainCreateInfo{XR_TYPE_SWAPCHAIN_CREATE_INFO};
+        swapchainCreateInfo.usageFlags = XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+        swapchainCreateInfo.format = m_colorSwapchainFormat;
+        swapchainCreateInfo.sampleCount = 1;
+        swapchainCreateInfo.width = ReplayViewWidth;
+        swapchainCreateInfo.height = ReplayViewHeight;
+        swapchainCreateInfo.faceCount = 1;
+        swapchainCreateInfo.arraySize = m_multiview ? (uint32_t)m_views.size() : 1;
+        swapchainCreateInfo.mipCount = 1;
+        for (size_t i = 0; i < (m_multiview ? 1 : m_views.size()); i++) {
+            m_images.push_back(m_graphicsPlugin->AllocateOffscreenImages(ReplayImageCount, swapchainCreateInfo));
+        }
+
+        for (uint32_t i = 0; i < m_views.size(); i++) {
+            m_views[i] = {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW};
+            m_views[i].pose = PoseAt(i == 0 ? -0.032f : 0.032f, 1.6f, 0);
+            m_views[i].fov = {-0.785398f, 0.785398f, 0.785398f, -0.785398f};
+            m_views[i].subImage.imageRect = {{0, 0}, {ReplayViewWidth, ReplayViewHeight}};
+            m_views[i].subImage.imageArrayIndex = m_multiview ? i : 0;
+        }
+        Log::Write(Log::Level::Info, Fmt("Rendering the replay offscreen at %dx%d per eye%s", ReplayViewWidth,
+                                         ReplayViewHeight, m_multiview ? " with multiview" : ""));
+    }
+
+    // Walk the session through the states a runtime would report: running from the first call, exiting once the
+    // replay has ended.
+    void PollEvents(bool* exitRenderLoop, bool* requestRestart) override {
+        *exitRenderLoop = *requestRestart = false;
+
+        if (m_sessionState == XR_SESSION_STATE_IDLE) {
+            SetSessionState(XR_SESSION_STATE_READY);
+            // xrBeginSession: XrTime is anchored to the steady clock here.
+            m_steadyStart = std::chrono::steady_clock::now();
+            m_steadyStartSeconds = std::chrono::duration<double>(m_steadyStart.time_since_epoch()).count();
+            m_clockStarted = true;
+            m_sessionRunning = true;
+            SetSessionState(XR_SESSION_STATE_SYNCHRONIZED);
+            SetSessionState(XR_SESSION_STATE_VISIBLE);
+            SetSessionState(XR_SESSION_STATE_FOCUSED);
+        } else if (m_sessionRunning && m_replayEnded) {
+            SetSessionState(XR_SESSION_STATE_VISIBLE);
+            SetSessionState(XR_SESSION_STATE_SYNCHRONIZED);
+            SetSessionState(XR_SESSION_STATE_STOPPING);
+            m_sessionRunning = false;
+            SetSessionState(XR_SESSION_STATE_IDLE);
+            SetSessionState(XR_SESSION_STATE_EXITING);
+            *exitRenderLoop = true;
+        }
+    }
+
+    bool IsSessionRunning() const override { return m_sessionRunning; }
+
+    bool IsSessionFocused() const override { return m_sessionState == XR_SESSION_STATE_FOCUSED; }
+
+    void PollActions() override {}
+
+    XrTime RenderFrame() override {
+        CHECK(m_sessionRunning);
+
+        const XrTime displayTime = ReplayStartTime + XrTime(m_frameCount) * m_framePeriod;
+        m_frameCount++;
+        FrameTiming& timing = m_frameTimings.push();
+        timing.displayTime = displayTime;
+        timing.displayPeriodMs = m_framePeriod * 1e-6;
+
+        // Hand out frames no faster than they would be displayed, like xrWaitFrame. Display times never skip, so a caller
+        // that falls behind shows up as periods missed against the wall clock.
+        if (m_options->ReplayRealTime) {
+            const auto due = m_steadyStart + std::chrono::nanoseconds(displayTime - ReplayStartTime);
+            const auto now = std::chrono::steady_clock::now();
+            std::this_thread::sleep_until(due);
+            timing.waitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - now).count();
+            if (now > due) {
+                timing.missedPeriods = uint32_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count() / m_framePeriod);
+            }
+        }
+
+        if (m_graphicsPlugin != nullptr) {
+            const auto start = std::chrono::steady_clock::now();
+            m_graphicsPlugin->BeginFrameTiming(timing.frame);
+            RenderLayer(displayTime);
+            timing.renderCpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            CollectGpuTimings(*m_graphicsPlugin, m_frameTimings);
+            m_frameArena.reset();
+        }
+
+        if (ReplayTime(displayTime) >= m_duration) {
+            m_replayEnded = true;
+        }
+        return displayTime;
+    }
+
+    // As OpenXrProgram::RenderLayer, for the replayed controllers and the next offscreen image of each view. The composed
+    // layer has no runtime to go to and is dropped with the frame arena.
+    void RenderLayer(XrTime displayTime) {
+        FrameLayer frameLayer(m_frameArena, m_views.size(), Side::COUNT);
+        for (auto hand : {Side::LEFT, Side::RIGHT}) {
+            frameLayer.AddCube(getControllerState(displayTime, hand).location, {0.1f, 0.1f, 0.1f});
+        }
+
+        const uint32_t image = uint32_t(m_frameCount % ReplayImageCount);
+        frameLayer.projectionViews.resize(m_views.size());
+        for (size_t i = 0; i < m_views.size(); i++) {
+            frameLayer.projectionViews[i] = m_views[i];
+        }
+        if (m_multiview) {
+            m_graphicsPlugin->RenderMultiview(frameLayer.projectionViews.data(), (uint32_t)m_views.size(), m_images[0][image],
+                                              m_colorSwapchainFormat, frameLayer.cubes);
+        } else {
+            for (size_t i = 0; i < m_views.size(); i++) {
+                m_graphicsPlugin->RenderView(frameLayer.projectionViews[i], m_images[i][image], m_colorSwapchainFormat,
+                                             frameLayer.cubes);
+            }
+        }
+        frameLayer.Submit(XR_NULL_HANDLE);
+    }
+
+    bool isHeadless() const override { return true; }
+
+    XrSpaceLocation getControllerSpace(XrTime predictedDisplayTime, int hand) override {
+        return getControllerState(predictedDisplayTime, hand).location;
+    }
+
+    // Interpolate the pose at time between the samples around it, velocities from the difference of those samples.
+    // Held at the first or last sample outside the recording.
+    ControllerState getControllerState(XrTime time, int hand) override {
+        ControllerState state{{XR_TYPE_SPACE_LOCATION}, {XR_TYPE_SPACE_VELOCITY}};
+        const std::vector<PoseSample>& samples = m_samples[hand];
+        if (samples.empty()) {
+            state.location.pose = PoseAt(0, 0, 0);
+            return state;
+        }
+
+        state.location.locationFlags = XR_SPACE_LOCATION_POSITION_VALID_BIT | XR_SPACE_LOCATION_ORIENTATION_VALID_BIT |
+                                       XR_SPACE_LOCATION_POSITION_TRACKED_BIT | XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT;
+        const double t = ReplayTime(time);
+        auto next = std::upper_bound(samples.begin(), samples.end(), t,
+                                     [](double value, const PoseSample& sample) { return value < sample.time; });
+        if (next == samples.begin() || next == samples.end() || samples.size() < 2) {
+            state.location.pose = next == samples.begin() ? samples.front().pose : samples.back().pose;
+            state.velocity.velocityFlags = XR_SPACE_VELOCITY_LINEAR_VALID_BIT | XR_SPACE_VELOCITY_ANGULAR_VALID_BIT;
+            return state;
+        }
+
+        const PoseSample& a = *std::prev(next);
+        const PoseSample& b = *next;
+        const double dt = b.time - a.time;
+        const float fraction = (float)((t - a.time) / dt);
+        XrVector3f_Lerp(&state.location.pose.position, &a.pose.position, &b.pose.position, fraction);
+        XrQuaternionf_Lerp(&state.location.pose.orientation, &a.pose.orientation, &b.pose.orientation, fraction);
+
+        XrVector3f_Sub(&state.velocity.linearVelocity, &b.pose.position, &a.pose.position);
+        XrVector3f_Scale(&state.velocity.linearVelocity, &state.velocity.linearVelocity, (float)(1 / dt));
+        // Small rotation b * a^-1 = (axis * angle / 2, 1)
+        const XrQuaternionf aInverse{-a.pose.orientation.x, -a.pose.orientation.y, -a.pose.orientation.z, a.pose.orientation.w};
+        XrQuaternionf delta;
+        XrQuaternionf_Multiply(&delta, &aInverse, &b.pose.orientation);
+        const float sign = delta.w < 0 ? -1.0f : 1.0f;
+        state.velocity.angularVelocity = {delta.x, delta.y, delta.z};
+        XrVector3f_Scale(&state.velocity.angularVelocity, &state.velocity.angularVelocity, sign * (float)(2 / dt));
+        state.velocity.velocityFlags = XR_SPACE_VELOCITY_LINEAR_VALID_BIT | XR_SPACE_VELOCITY_ANGULAR_VALID_BIT;
+        return state;
+    }
+
+    bool isHandActive(int hand) override { return !m_samples[hand].empty(); }
+
+    void startTracking(double rateHz) override {
+        CHECK(rateHz > 0);
+
+        stopTracking();
+        m_trackingRunning = true;
+        m_trackingThread = std::thread(&ReplayProgram::TrackingLoop, this, rateHz);
+        Log::Write(Log::Level::Info, Fmt("Tracking replayed controllers at %.0f Hz", rateHz));
+    }
+
+    void stopTracking() override {
+        m_trackingRunning = false;
+        m_trackingSignal.notify();
+        if (m_trackingThread.joinable()) {
+            m_trackingThread.join();
+        }
+    }
+
+    TrackedControllerState getTrackedControllerState(int hand) const override {
+        TrackedControllerState tracked{};
+        m_trackedControllers[hand].load(tracked);
+        return tracked;
+    }
+
+    TrackedControllerState waitTrackedControllerState(int hand, uint64_t sample, std::chrono::microseconds timeout) override {
+        m_trackingSignal.wait(timeout, [&]() { return m_trackedControllers[hand].getVersion() != sample || !m_trackingRunning; });
+        return getTrackedControllerState(hand);
+    }
+
+    // XrTime runs at the steady clock's rate from ReplayStartTime, when the session began.
+    double toSteadyTime(XrTime time) const override {
+        return m_clockStarted ? m_steadyStartSeconds + (time - ReplayStartTime) * 1e-9 : 0;
+    }
+
+    XrTime toXrTime(double steadyTime) const override {
+        return m_clockStarted ? ReplayStartTime + XrTime((steadyTime - m_steadyStartSeconds) * 1e9) : 0;
+    }
+
+    const FrameTimingHistory& getFrameTimings() const override { return m_frameTimings; }
+
+    FramePacingSummary getFramePacingSummary() const override { return m_frameTimings.summarize(); }
+
+   private:
+    // Seconds into the replay at time.
+    static double ReplayTime(XrTime time) { return (time - ReplayStartTime) * 1e-9; }
+
+    void SetSessionState(XrSessionState state) {
+        Log::Write(Log::Level::Info, Fmt("Replay session state %s->%s", to_string(m_sessionState.load()), to_string(state)));
+        m_sessionState = state;
+    }
+
+    // As OpenXrProgram::TrackingLoop, sampling the replay at the current time. Does not step XrTime itself, so tracked
+    // samples follow the wall clock rather than the frames.
+    void TrackingLoop(double rateHz) {
+        const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rateHz));
+        auto next = std::chrono::steady_clock::now();
+
+        while (m_trackingRunning) {
+            if (m_sessionRunning) {
+                const XrTime now = toXrTime(std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count());
+                for (auto hand : {Side::LEFT, Side::RIGHT}) {
+                    TrackedControllerState tracked{getControllerState(now, hand), now, m_trackedControllers[hand].getVersion() + 1};
+                    m_trackedControllers[hand].store(tracked);
+                }
+                m_trackingSignal.notify();
+            }
+
+            next += period;
+            const auto wake = std::chrono::steady_clock::now();
+            if (next < wake) {
+                next = wake;
+            }
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    const std::shared_ptr<Options> m_options;
+    const std::shared_ptr<IGraphicsPlugin> m_graphicsPlugin;  // Null renders nothing.
+    bool m_graphicsInitialized{false};
+    bool m_multiview{false};
+    int64_t m_colorSwapchainFormat{-1};
+    std::array<XrCompositionLayerProjectionView, 2> m_views{};
+    std::vector<std::vector<XrSwapchainImageBaseHeader*>> m_images;  // Per swapchain, ReplayImageCount images.
+    FrameArena m_frameArena{16 * 1024};
+    XrDuration m_framePeriod{0};
+    std::array<std::vector<PoseSample>, Side::COUNT> m_samples;  // Read once, then only read from any thread.
+    double m_duration{0};                                        // Time of the last sample [s].
+
+    std::atomic<XrSessionState> m_sessionState{XR_SESSION_STATE_UNKNOWN};
+    std::atomic<bool> m_sessionRunning{false};
+    bool m_replayEnded{false};
+    uint64_t m_frameCount{0};
+
+    std::chrono::steady_clock::time_point m_steadyStart{};
+    double m_steadyStartSeconds{0};
+    std::atomic<bool> m_clockStarted{false};
+
+    FrameTimingHistory m_frameTimings;
+
+    std::thread m_trackingThread;
+    std::atomic<bool> m_trackingRunning{false};
+    std::array<Seqlock<TrackedControllerState>, Side::COUNT> m_trackedControllers;
+    SampleSignal m_trackingSignal;  // Wakes waitTrackedControllerState after each pair of samples.
+};
+}  // namespace
+
+std::shared_ptr<IOpenXrProgram> CreateReplayProgram(const std::shared_ptr<Options>& options,
+                                                    const std::shared_ptr<IGraphicsPlugin>& graphicsPlugin) {
+    return std::make_shared<ReplayProgram>(options, graphicsPlugin);
+}
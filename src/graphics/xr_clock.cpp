@@ -0,0 +1,87 @@
+#include "pch.h"
+#include "common.h"
+#include "logger.h"
+#include "check.h"
+#include "xr_clock.h"
+#include <chrono>
+
+void XrClock::initialize(XrInstance instance, bool extensionEnabled) {
+    m_instance = instance;
+    m_convertToXrTime = nullptr;
+    if (extensionEnabled) {
+        CHECK_XRCMD(xrGetInstanceProcAddr(instance, "xrConvertTimespecTimeToTimeKHR",
+                                          reinterpret_cast<PFN_xrVoidFunction*>(&m_convertToXrTime)));
+    }
+
+    if (usesRuntimeConversion() && calibrate()) {
+        Log::Write(Log::Level::Info, "Converting XrTime with XR_KHR_convert_timespec_time");
+    } else {
+        m_convertToXrTime = nullptr;
+        Log::Write(Log::Level::Warning, "XR_KHR_convert_timespec_time unavailable, estimating XrTime from frame timing");
+    }
+}
+
+void XrClock::update(XrTime waitFrameTime) {
+    const int64_t steadyNs = steadyNowNs();
+    if (isCalibrated() && steadyNs - m_lastCalibrationNs < kRecalibrationIntervalNs) {
+        return;
+    }
+
+    if (usesRuntimeConversion()) {
+        calibrate();
+    } else {
+        setReference(steadyNs, waitFrameTime);
+    }
+}
+
+bool XrClock::calibrate() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    XrTime xrTime;
+    if (XR_FAILED(m_convertToXrTime(m_instance, &ts, &xrTime))) {
+        return false;
+    }
+    setReference(int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec, xrTime);
+    return true;
+}
+
+void XrClock::setReference(int64_t steadyNs, XrTime xrTime) {
+    Mapping mapping{steadyNs, xrTime, m_current.rate, m_current.inverseRate};
+
+    // Frame timing jitters too much to fit a rate. The clocks run at the same nominal rate, so only trust a fitted rate close to 1.
+    if (usesRuntimeConversion() && isCalibrated() && steadyNs - m_current.steadyRef >= kRecalibrationIntervalNs) {
+        const double rate = double(xrTime - m_current.xrRef) / double(steadyNs - m_current.steadyRef);
+        if (std::abs(rate - 1.0) < 1e-3) {
+            mapping.rate = rate;
+            mapping.inverseRate = 1.0 / rate;
+        }
+    }
+
+    m_current = mapping;
+    m_mapping.store(mapping);
+    m_lastCalibrationNs = steadyNs;
+}
+
+bool XrClock::isCalibrated() const { return m_mapping.getVersion() != 0; }
+
+XrTime XrClock::toXrTime(double steadyTime) const {
+    Mapping mapping;
+    if (m_mapping.load(mapping) == 0) {
+        return 0;
+    }
+    return mapping.xrRef + XrTime(mapping.rate * (steadyTime * 1e9 - double(mapping.steadyRef)));
+}
+
+double XrClock::toSteadyTime(XrTime time) const {
+    Mapping mapping;
+    if (m_mapping.load(mapping) == 0) {
+        return 0;
+    }
+    return (double(mapping.steadyRef) + mapping.inverseRate * double(time - mapping.xrRef)) * 1e-9;
+}
+
+XrTime XrClock::now() const { return toXrTime(steadyNowNs() * 1e-9); }
+
+int64_t XrClock::steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
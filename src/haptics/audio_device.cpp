@@ -0,0 +1,85 @@
+#include <audio_device.hpp>
+#include <iostream>
+#include <vector>
+#include <pthread.h>
+#ifdef HAVE_ALSA
+#include <alsa/asoundlib.h>
+#endif
+
+AudioDevice::AudioDevice(SampleEngine &m_engine, const std::string &m_name, int m_period) : engine(m_engine), running(false) {
+    name = m_name;
+    period = m_period;
+    pcm = nullptr;
+}
+
+AudioDevice::~AudioDevice() {
+    stop();
+}
+
+bool AudioDevice::start() {
+    if (running) return true;
+
+#ifdef HAVE_ALSA
+    snd_pcm_t *handle;
+    int err = snd_pcm_open(&handle, name.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
+    if (err < 0) {
+        std::cerr << "Failed to open audio device " << name << ": " << snd_strerror(err) << std::endl;
+        return false;
+    }
+
+    //ask for two periods of buffering
+    unsigned int latency_us = 2*1000000ull*period/engine.getSampleRate();
+    err = snd_pcm_set_params(handle, SND_PCM_FORMAT_FLOAT_LE, SND_PCM_ACCESS_RW_INTERLEAVED, SampleEngine::channels, engine.getSampleRate(), 1, latency_us);
+    if (err < 0) {
+        std::cerr << "Failed to configure audio device " << name << ": " << snd_strerror(err) << std::endl;
+        snd_pcm_close(handle);
+        return false;
+    }
+
+    pcm = handle;
+    running = true;
+    thread = std::thread(&AudioDevice::run, this);
+    return true;
+#else
+    std::cerr << "Built without ALSA, no audio device available" << std::endl;
+    return false;
+#endif
+}
+
+void AudioDevice::stop() {
+    if (!running) return;
+    running = false;
+    if (thread.joinable()) thread.join();
+
+#ifdef HAVE_ALSA
+    snd_pcm_drain((snd_pcm_t*)pcm);
+    snd_pcm_close((snd_pcm_t*)pcm);
+#endif
+    pcm = nullptr;
+}
+
+void AudioDevice::run() {
+    //real-time priority if the user is allowed it, plain priority otherwise
+    sched_param param{};
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO)-1;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+        std::cerr << "Audio thread running without real-time priority" << std::endl;
+    }
+
+    std::vector<float> buffer(period*SampleEngine::channels);
+
+#ifdef HAVE_ALSA
+    snd_pcm_t *handle = (snd_pcm_t*)pcm;
+    while (running) {
+        engine.render(buffer.data(), period);
+
+        //writei blocks until the card has room, which paces the loop
+        snd_pcm_sframes_t written = snd_pcm_writei(handle, buffer.data(), period);
+        if (written < 0) written = snd_pcm_recover(handle, written, 1);
+        if (written < 0) {
+            std::cerr << "Audio write failed: " << snd_strerror(written) << std::endl;
+            break;
+        }
+    }
+#endif
+}
@@ -0,0 +1,84 @@
+#include <force_lut.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cmath>
+
+ForceLookupTable::ForceLookupTable() {
+    x0 = 0;
+    inv_dx = 0;
+    mode = Interpolation::Linear;
+}
+
+ForceLookupTable::ForceLookupTable(const std::function<double(double)> &f, double x_min, double x_max, int n, Interpolation m_mode) {
+    if (n < 2 || x_max <= x_min) throw std::invalid_argument("Force table needs at least 2 entries over a non-empty range");
+
+    double dx = (x_max-x_min)/(n-1);
+    x0 = x_min;
+    inv_dx = 1/dx;
+    mode = m_mode;
+    forces.resize(n);
+    for (int i=0; i<n; i++) forces[i] = f(x_min+i*dx);
+}
+
+ForceLookupTable::ForceLookupTable(const std::vector<std::pair<double,double>> &table, int n, Interpolation m_mode) :
+    ForceLookupTable(
+        [&table](double x) {
+            //piecewise linear through the measured points
+            auto it = std::lower_bound(table.begin(),table.end(),x,[](const std::pair<double,double> &p, double v) { return p.first < v; });
+            if (it == table.begin()) return table.front().second;
+            if (it == table.end()) return table.back().second;
+            auto prev = it-1;
+            double s = (x-prev->first)/(it->first-prev->first);
+            return (1-s)*prev->second + s*it->second;
+        },
+        table.empty() ? 0 : table.front().first,
+        table.empty() ? 0 : table.back().first,
+        n, m_mode) {}
+
+double ForceLookupTable::evaluate(double x) const {
+    const int n = forces.size();
+    if (n == 0) return 0;
+
+    double u = (x-x0)*inv_dx;
+    if (u <= 0) return forces[0];
+    if (u >= n-1) return forces[n-1];
+
+    int i = (int)u;
+    float s = u-i;
+
+    if (mode == Interpolation::Linear) return forces[i] + s*(forces[i+1]-forces[i]);
+
+    //Catmull-Rom with linearly extrapolated neighbours at the boundaries
+    float p1 = forces[i];
+    float p2 = forces[i+1];
+    float p0 = i > 0 ? forces[i-1] : 2*p1-p2;
+    float p3 = i+2 < n ? forces[i+2] : 2*p2-p1;
+    return p1 + 0.5f*s*(p2-p0 + s*(2*p0-5*p1+4*p2-p3 + s*(3*(p1-p2)+p3-p0)));
+}
+
+int ForceLookupTable::size() const {
+    return forces.size();
+}
+
+bool loadForceTable(const std::string &filename, std::vector<std::pair<double,double>> &table) {
+    std::ifstream datafile(filename);
+    if (!datafile.is_open()) return false;
+
+    std::string line;
+    std::getline(datafile,line);
+    while (std::getline(datafile,line)) {
+        std::stringstream row(line);
+        std::string x, f;
+        if (!std::getline(row,x,',') || !std::getline(row,f,',')) continue;
+        try {
+            table.push_back({std::stod(x),std::stod(f)});
+        }
+        catch (const std::exception&) {
+            continue;
+        }
+    }
+    std::sort(table.begin(),table.end());
+    return table.size() >= 2;
+}
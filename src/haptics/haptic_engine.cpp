@@ -0,0 +1,31 @@
+#include <haptic_engine.hpp>
+
+HapticScene::HapticScene() : HapticScene(DBL_MAX) {}
+
+HapticScene::HapticScene(double m_max_force) {
+    max_force = m_max_force;
+}
+
+void HapticScene::add(const HapticPrimitive &primitive) {
+    primitives.push_back(primitive);
+}
+
+void HapticScene::clear() {
+    primitives.clear();
+}
+
+double HapticScene::evaluate(double position, double velocity) const {
+    double force = 0;
+    for (const auto &primitive : primitives) {
+        force += std::visit([&](const auto &p) { return p.force(position,velocity); }, primitive);
+    }
+    return std::max(-max_force,std::min(force,max_force));
+}
+
+int HapticScene::size() const {
+    return primitives.size();
+}
+
+std::vector<HapticPrimitive>& HapticScene::getPrimitives() {
+    return primitives;
+}
@@ -2,6 +2,8 @@
 #include <float.h>
 #include <cmath>
 #include <iostream>
+#include <fstream>
+#include <sstream>
 
 namespace geometry {
     double normalize_angle(double rad) {
@@ -15,6 +17,14 @@ namespace geometry {
         }
         return rad;
     }
+
+    Eigen::Vector3f pointVelocity(const Eigen::Transform<float,3,Eigen::Affine> &Twb, const Eigen::Vector3f &body_linear_velocity, const Eigen::Vector3f &body_angular_velocity, const Eigen::Transform<float,3,Eigen::Affine> &Tbp) {
+        //lever arm from body origin to point expressed in world frame
+        Eigen::Vector3f r = Twb.linear()*Tbp.translation();
+
+        //v_p = v_b + w x r
+        return body_linear_velocity + body_angular_velocity.cross(r);
+    }
 }
 
 double map(double val, std::pair<double,double> input_range, std::pair<double,double> output_range) {
@@ -33,6 +43,9 @@ Drum::Drum() {
     level_limits.first = 0;
     level_limits.second = 3;
     id = 0;
+    surface.position = center[2];
+    surface.direction = -1;
+    surface.quadratic = true;
 }
 
 Drum::Drum(int m_id, Eigen::Vector3f m_center, double m_length, double m_width, double m_k, std::pair<double,double> m_sustain_limits, std::pair<double,double> m_level_limits) {
@@ -43,6 +56,12 @@ Drum::Drum(int m_id, Eigen::Vector3f m_center, double m_length, double m_width,
     level_limits = m_level_limits;
     sustain_limits = m_sustain_limits;
     id = m_id;
+
+    //square displacement to make K units N/m
+    surface.position = center[2];
+    surface.stiffness = k;
+    surface.direction = -1;
+    surface.quadratic = true;
 }
 
 bool Drum::withinDrumBoundaries(const Eigen::Vector3f& drumstick_position) {
@@ -56,23 +75,23 @@ double Drum::calculateDistance(const Eigen::Vector3f &drumstick_position) {
 }
 
 double Drum::calculateTorque(const float &drumstick_z_position) {
-    double torque_lim = DBL_MAX;
-    double displacement = drumstick_z_position-center[2];
-
-    if (displacement < 0) {
-
-        //square displacement to make K units N/m
-        displacement = pow(displacement,2);
+    if (surface_curve.curve != nullptr) return surface_curve.force(drumstick_z_position,0);
+    return surface.force(drumstick_z_position,0);
+}
 
-        //calculate toque
-        double torque = abs(k*displacement);
+void Drum::setSurfaceCurve(const ForceLookupTable *curve) {
+    surface_curve.position = center[2];
+    surface_curve.direction = -1;
+    surface_curve.curve = curve;
+}
 
-        //clamp torque
-        torque = std::min(torque,torque_lim);
+void Drum::setOutput(HitOutput *m_output) {
+    output = m_output;
+}
 
-        return torque;
-    }
-    else return 0;
+void Drum::enablePredictiveTrigger(double lookahead) {
+    predictive = true;
+    trigger.setLookahead(lookahead);
 }
 
 bool Drum::checkContact(const float &drumstick_z_position) {
@@ -96,7 +115,27 @@ bool Drum::checkContact(const float &drumstick_z_position) {
     }
 }
 
-void Drum::sendToPureData(const Eigen::Vector3f &drumstick_position, const double &drumstick_velocity) {
+DrumContact Drum::sweep(const DrumstickState &previous, const DrumstickState &current) {
+    DrumContact contact;
+
+    //only a downward crossing of the drum plane is a strike
+    double z0 = previous.position[2]-center[2];
+    double z1 = current.position[2]-center[2];
+    if (z0 < 0 || z1 >= 0) return contact;
+
+    //interpolate the crossing along the segment
+    double s = z0/(z0-z1);
+    Eigen::Vector3f point = previous.position + s*(current.position-previous.position);
+    if (!withinDrumBoundaries(point)) return contact;
+
+    contact.hit = true;
+    contact.time = previous.time + s*(current.time-previous.time);
+    contact.position = point;
+    contact.velocity = previous.velocity + s*(current.velocity-previous.velocity);
+    return contact;
+}
+
+void Drum::sendToPureData(const Eigen::Vector3f &drumstick_position, const double &drumstick_velocity, double time) {
     //calculate sustain command
     double distance_to_center = calculateDistance(drumstick_position);
     double sustain_input_limit = sqrt(pow(length,2)+pow(width,2))/2;
@@ -108,7 +147,14 @@ void Drum::sendToPureData(const Eigen::Vector3f &drumstick_position, const doubl
     double level_cmd = map(drumstick_velocity,level_input_range,level_limits);
 
     //send commands
-    std::cout << id << " " << level_cmd << " " << sustain_cmd << ";" << std::endl;
+    HitEvent hit;
+    hit.id = id;
+    hit.level = level_cmd;
+    hit.sustain = sustain_cmd;
+    hit.time = time;
+    last_hit = hit;
+    if (output != nullptr) output->send(hit);
+    else StdoutOutput().send(hit);
 }
 
 double Drum::update(const Eigen::Vector3f &drumstick_position, const double &drumstick_velocity) {
@@ -123,6 +169,35 @@ double Drum::update(const Eigen::Vector3f &drumstick_position, const double &dru
     return torque;
 }
 
+double Drum::update(const DrumstickState &previous, const DrumstickState &current) {
+    if (predictive) {
+        TriggerResult result = trigger.update(current.time,current.position[2]-center[2],current.velocity[2]);
+        if (result.action == TriggerAction::Fire) {
+            //where the tip meets the head at the forecast time
+            Eigen::Vector3f point = current.position + (result.contact_time-current.time)*current.velocity;
+            hit_pending = withinDrumBoundaries(point);
+            if (hit_pending) sendToPureData(point,std::abs(result.velocity),result.contact_time);
+        }
+        else if (result.action == TriggerAction::Cancel && hit_pending) {
+            if (output != nullptr) output->cancel(last_hit);
+            hit_pending = false;
+        }
+        else if (result.action == TriggerAction::Confirm) hit_pending = false;
+    }
+    else {
+        //Send value commands to PD if the drumstick passed through the head since the last sample
+        DrumContact contact = sweep(previous,current);
+        if (contact.hit) sendToPureData(contact.position,std::abs(contact.velocity[2]),contact.time);
+    }
+
+    //enforce drum boundaries
+    if (!withinDrumBoundaries(current.position)) return 0;
+
+    //calculate torque
+    double torque = calculateTorque(current.position[2]);
+    return torque;
+}
+
 ExponentialFilter::ExponentialFilter(int n){
     alpha = 1;
     for (int i=0; i<n; i++) forecast.push_back(0);
@@ -158,4 +233,38 @@ Eigen::Vector3f ExponentialFilter::getForcastFloat() {
     Eigen::Vector3f forecast_vector;
     forecast_vector << x,y,z;
     return forecast_vector;
-}
\ No newline at end of file
+}
+
+bool readHeightRecording(const std::string &filename, std::vector<double> &times, std::vector<double> &heights) {
+    std::ifstream datafile(filename);
+    if (!datafile.is_open()) return false;
+
+    std::string line;
+    std::getline(datafile,line);
+    while (std::getline(datafile,line)) {
+        std::stringstream row(line);
+        std::string t, z;
+        if (!std::getline(row,t,',') || !std::getline(row,z,',')) continue;
+        try {
+            double time = std::stod(t);
+            if (!times.empty() && time <= times.back()) continue;
+            times.push_back(time);
+            heights.push_back(std::stod(z));
+        }
+        catch (const std::exception&) {
+            continue;
+        }
+    }
+    return times.size() >= 3;
+}
+
+std::vector<double> filteredVelocity(const std::vector<double> &times, const std::vector<double> &positions, double alpha) {
+    std::vector<double> velocities(times.size(),0);
+    ExponentialFilter ef(1,alpha);
+    for (int i=1; i<times.size(); i++) {
+        std::vector<double> v{(positions[i]-positions[i-1])/(times[i]-times[i-1])};
+        ef.filterData(v);
+        velocities[i] = ef.getForcast()[0];
+    }
+    return velocities;
+}
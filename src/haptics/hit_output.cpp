@@ -0,0 +1,147 @@
+#include <hit_output.hpp>
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+double steadyTime() {
+    return std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void StdoutOutput::send(const HitEvent &hit) {
+    std::cout << hit.id << " " << hit.level << " " << hit.sustain << ";" << std::endl;
+}
+
+FudiClient::FudiClient(const std::string &host, int port, FudiProtocol m_protocol) {
+    protocol = m_protocol;
+    connected = false;
+    dropped = 0;
+    pending_length = 0;
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET,host.c_str(),&address.sin_addr) != 1) {
+        std::cerr << "Invalid Pure Data address " << host << ", sending hits to stdout" << std::endl;
+        fd = -1;
+        return;
+    }
+
+    fd = socket(AF_INET, protocol == FudiProtocol::TCP ? SOCK_STREAM : SOCK_DGRAM, 0);
+    if (fd < 0) {
+        fallback();
+        return;
+    }
+    fcntl(fd,F_SETFL,fcntl(fd,F_GETFL,0) | O_NONBLOCK);
+
+    //send each hit as soon as it is written instead of waiting to coalesce
+    if (protocol == FudiProtocol::TCP) {
+        int flag = 1;
+        setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&flag,sizeof(flag));
+    }
+
+    //UDP connect only sets the default destination, TCP may still be in progress
+    if (connect(fd,(sockaddr*)&address,sizeof(address)) == 0) connected = true;
+    else if (errno != EINPROGRESS) fallback();
+}
+
+FudiClient::~FudiClient() {
+    if (fd >= 0) close(fd);
+}
+
+bool FudiClient::pollConnection() {
+    if (connected) return true;
+
+    pollfd p{fd,POLLOUT,0};
+    if (poll(&p,1,0) <= 0) return false;
+
+    int error = 0;
+    socklen_t length = sizeof(error);
+    getsockopt(fd,SOL_SOCKET,SO_ERROR,&error,&length);
+    if (error != 0) {
+        fallback();
+        return false;
+    }
+    connected = true;
+    return true;
+}
+
+void FudiClient::fallback() {
+    std::cerr << "Could not reach Pure Data, sending hits to stdout" << std::endl;
+    if (fd >= 0) close(fd);
+    fd = -1;
+}
+
+bool FudiClient::writeWouldBlock() {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return true;
+    fallback();
+    return false;
+}
+
+bool FudiClient::flushPending() {
+    if (pending_length == 0) return true;
+    ssize_t written = ::send(fd,pending,pending_length,MSG_NOSIGNAL);
+    if (written < 0) {
+        writeWouldBlock();
+        return false;
+    }
+    pending_length -= written;
+    memmove(pending,pending+written,pending_length);
+    return pending_length == 0;
+}
+
+void FudiClient::send(const HitEvent &hit) {
+    if (fd < 0) {
+        stdout_output.send(hit);
+        return;
+    }
+
+    //a hit during the TCP handshake is dropped rather than waited on
+    if (!pollConnection()) {
+        if (fd < 0) stdout_output.send(hit);
+        else dropped++;
+        return;
+    }
+
+    //finish the previous message first, a new one cannot start inside it
+    if (!flushPending()) {
+        if (fd < 0) stdout_output.send(hit);
+        else dropped++;
+        return;
+    }
+
+    int n = snprintf(buffer,sizeof(buffer),"%d %.4f %.4f;\n",hit.id,hit.level,hit.sustain);
+    if (n <= 0 || n >= (int)sizeof(buffer)) return;
+
+    ssize_t written = ::send(fd,buffer,n,MSG_NOSIGNAL);
+    if (written == n) return;
+    if (written >= 0) {
+        //a stream socket took only part of the message, keep the rest for the next send
+        pending_length = n-written;
+        memcpy(pending,buffer+written,pending_length);
+        return;
+    }
+    if (writeWouldBlock()) {
+        dropped++;
+        return;
+    }
+
+    //Pure Data went away, keep the hit audible through stdout
+    stdout_output.send(hit);
+}
+
+bool FudiClient::isConnected() {
+    return fd >= 0 && pollConnection();
+}
+
+int FudiClient::getDroppedCount() {
+    return dropped;
+}
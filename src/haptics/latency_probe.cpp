@@ -0,0 +1,100 @@
+#include <latency_probe.hpp>
+#include <algorithm>
+#include <cmath>
+
+const char* toString(LatencyStage stage) {
+    switch (stage) {
+        case LatencyStage::Pose: return "pose";
+        case LatencyStage::Filter: return "filter";
+        case LatencyStage::Update: return "update";
+        case LatencyStage::Torque: return "torque";
+        case LatencyStage::Hit: return "hit";
+    }
+    return "unknown";
+}
+
+LatencyProbe::LatencyProbe() : LatencyProbe(-50,200,0.01) {}
+
+LatencyProbe::LatencyProbe(double m_min_ms, double m_max_ms, double m_bin_ms) {
+    min_ms = m_min_ms;
+    bin_ms = m_bin_ms;
+    bin_count = std::max(1,int(std::ceil((m_max_ms-m_min_ms)/m_bin_ms)));
+    for (auto &h : stage) h.bins.assign(bin_count,0);
+    for (auto &h : end_to_end) h.bins.assign(bin_count,0);
+    pose_time = 0;
+    last_time = 0;
+}
+
+void LatencyProbe::beginSample(double m_pose_time) {
+    pose_time = m_pose_time;
+    last_time = m_pose_time;
+    stamp(LatencyStage::Pose);
+}
+
+void LatencyProbe::stamp(LatencyStage s) {
+    stamp(s,steadyTime());
+}
+
+void LatencyProbe::stamp(LatencyStage s, double time) {
+    int i = int(s);
+    add(stage[i],(time-last_time)*1000);
+    add(end_to_end[i],(time-pose_time)*1000);
+
+    //hits are sent from inside the update, so they branch off the pipeline rather than follow it
+    if (s != LatencyStage::Hit) last_time = time;
+}
+
+void LatencyProbe::add(Histogram &histogram, double ms) {
+    int bin = std::max(0,std::min(int((ms-min_ms)/bin_ms),bin_count-1));
+    histogram.bins[bin]++;
+    histogram.max = histogram.count == 0 ? ms : std::max(histogram.max,ms);
+    histogram.count++;
+    histogram.sum += ms;
+}
+
+double LatencyProbe::percentile(const Histogram &histogram, double p) const {
+    if (histogram.count == 0) return 0;
+    int target = std::max(1,int(std::ceil(p/100*histogram.count)));
+    int seen = 0;
+    for (int i=0; i<bin_count; i++) {
+        seen += histogram.bins[i];
+        if (seen >= target) return std::min(min_ms+(i+0.5)*bin_ms,histogram.max);
+    }
+    return histogram.max;
+}
+
+double LatencyProbe::getPercentile(LatencyStage s, double p, bool from_pose) const {
+    return percentile(from_pose ? end_to_end[int(s)] : stage[int(s)],p);
+}
+
+int LatencyProbe::getSampleCount(LatencyStage s) const {
+    return stage[int(s)].count;
+}
+
+void LatencyProbe::report(std::ostream &out) const {
+    out << "Stage," << " Measured from," << " Samples," << " Mean (ms)," << " p50 (ms)," << " p90 (ms)," << " p99 (ms)," << " Max (ms)" << "\n";
+    for (int i=0; i<stage_count; i++) {
+        for (int from_pose=0; from_pose<2; from_pose++) {
+            const Histogram &h = from_pose ? end_to_end[i] : stage[i];
+            if (h.count == 0) continue;
+            out << toString(LatencyStage(i)) << "," << (from_pose ? "pose" : "previous stage") << "," << h.count << "," << h.sum/h.count << ","
+                << percentile(h,50) << "," << percentile(h,90) << "," << percentile(h,99) << "," << h.max << "\n";
+        }
+    }
+}
+
+void LatencyProbe::reset() {
+    for (auto &h : stage) h = Histogram{std::vector<int>(bin_count,0)};
+    for (auto &h : end_to_end) h = Histogram{std::vector<int>(bin_count,0)};
+}
+
+ProbedOutput::ProbedOutput(HitOutput &m_output, LatencyProbe &m_probe) : output(m_output), probe(m_probe) {}
+
+void ProbedOutput::send(const HitEvent &hit) {
+    output.send(hit);
+    probe.stamp(LatencyStage::Hit);
+}
+
+void ProbedOutput::cancel(const HitEvent &hit) {
+    output.cancel(hit);
+}
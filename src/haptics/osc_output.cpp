@@ -0,0 +1,162 @@
+#include <osc_output.hpp>
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+OscOutput::OscOutput(const std::string &host, int port) {
+    dropped = 0;
+
+    //seconds from the NTP epoch (1900) to the unix epoch (1970)
+    const double ntp_unix_offset = 2208988800.0;
+    double unix_now = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::system_clock::now().time_since_epoch()).count();
+    ntp_offset = unix_now+ntp_unix_offset-steadyTime();
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET,host.c_str(),&address.sin_addr) != 1) {
+        std::cerr << "Invalid OSC address " << host << std::endl;
+        fd = -1;
+        return;
+    }
+
+    fd = socket(AF_INET,SOCK_DGRAM,0);
+    if (fd < 0) {
+        std::cerr << "Could not open OSC socket" << std::endl;
+        return;
+    }
+    fcntl(fd,F_SETFL,fcntl(fd,F_GETFL,0) | O_NONBLOCK);
+
+    //fix the destination so each packet is a single send call
+    if (connect(fd,(sockaddr*)&address,sizeof(address)) != 0) {
+        std::cerr << "Could not reach OSC receiver " << host << ":" << port << std::endl;
+        close(fd);
+        fd = -1;
+    }
+}
+
+OscOutput::~OscOutput() {
+    if (fd >= 0) close(fd);
+}
+
+uint64_t OscOutput::toTimetag(double time) {
+    //timetag 1 means immediately
+    if (time <= 0) return 1;
+    double ntp = time+ntp_offset;
+    uint64_t seconds = uint64_t(ntp);
+    uint64_t fraction = uint64_t((ntp-seconds)*4294967296.0);
+    return (seconds << 32) | fraction;
+}
+
+void OscOutput::writeInt(Packet &packet, int32_t value) {
+    if (packet.size+4 > (int)sizeof(packet.data)) {
+        packet.overflow = true;
+        return;
+    }
+    uint32_t big_endian = htonl(uint32_t(value));
+    std::memcpy(packet.data+packet.size,&big_endian,4);
+    packet.size += 4;
+}
+
+void OscOutput::writeFloat(Packet &packet, float value) {
+    int32_t bits;
+    std::memcpy(&bits,&value,4);
+    writeInt(packet,bits);
+}
+
+void OscOutput::writeString(Packet &packet, const char *value) {
+    int length = std::strlen(value)+1;
+    int padded = (length+3) & ~3;
+    if (packet.size+padded > (int)sizeof(packet.data)) {
+        packet.overflow = true;
+        return;
+    }
+    std::memcpy(packet.data+packet.size,value,length);
+    std::memset(packet.data+packet.size+length,0,padded-length);
+    packet.size += padded;
+}
+
+void OscOutput::beginBundle(Packet &packet, double time) {
+    packet.size = 0;
+    packet.overflow = false;
+    writeString(packet,"#bundle");
+    uint64_t timetag = toTimetag(time);
+    writeInt(packet,int32_t(timetag >> 32));
+    writeInt(packet,int32_t(timetag & 0xFFFFFFFF));
+}
+
+int OscOutput::beginMessage(Packet &packet, const char *address, const char *types) {
+    int size_offset = packet.size;
+    writeInt(packet,0);
+    writeString(packet,address);
+    writeString(packet,types);
+    return size_offset;
+}
+
+void OscOutput::endMessage(Packet &packet, int size_offset) {
+    if (packet.overflow) return;
+    uint32_t big_endian = htonl(uint32_t(packet.size-size_offset-4));
+    std::memcpy(packet.data+size_offset,&big_endian,4);
+}
+
+void OscOutput::transmit(Packet &packet) {
+    if (fd < 0 || packet.overflow || packet.size == 0) return;
+    if (::send(fd,packet.data,packet.size,0) != packet.size) dropped++;
+}
+
+void OscOutput::send(const HitEvent &hit) {
+    beginBundle(hit_packet,hit.time);
+    int message = beginMessage(hit_packet,"/drum/hit",",iff");
+    writeInt(hit_packet,hit.id);
+    writeFloat(hit_packet,hit.level);
+    writeFloat(hit_packet,hit.sustain);
+    endMessage(hit_packet,message);
+    transmit(hit_packet);
+}
+
+void OscOutput::cancel(const HitEvent &hit) {
+    beginBundle(hit_packet,hit.time);
+    int message = beginMessage(hit_packet,"/drum/cancel",",i");
+    writeInt(hit_packet,hit.id);
+    endMessage(hit_packet,message);
+    transmit(hit_packet);
+}
+
+void OscOutput::beginFrame(double time) {
+    beginBundle(frame_packet,time);
+}
+
+void OscOutput::addStick(const float position[3], const float velocity[3]) {
+    int message = beginMessage(frame_packet,"/stick/position",",fff");
+    for (int i=0; i<3; i++) writeFloat(frame_packet,position[i]);
+    endMessage(frame_packet,message);
+
+    message = beginMessage(frame_packet,"/stick/velocity",",fff");
+    for (int i=0; i<3; i++) writeFloat(frame_packet,velocity[i]);
+    endMessage(frame_packet,message);
+}
+
+void OscOutput::addTorque(double torque) {
+    int message = beginMessage(frame_packet,"/haptics/torque",",f");
+    writeFloat(frame_packet,torque);
+    endMessage(frame_packet,message);
+}
+
+void OscOutput::sendFrame() {
+    transmit(frame_packet);
+    frame_packet.size = 0;
+}
+
+bool OscOutput::isOpen() {
+    return fd >= 0;
+}
+
+int OscOutput::getDroppedCount() {
+    return dropped;
+}
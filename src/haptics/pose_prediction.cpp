@@ -0,0 +1,92 @@
+#include <pose_prediction.hpp>
+#include <algorithm>
+
+PosePredictor::PosePredictor() : PosePredictor(0.02) {}
+
+PosePredictor::PosePredictor(double m_max_horizon) {
+    max_horizon = m_max_horizon;
+    reset();
+}
+
+void PosePredictor::reset() {
+    head = capacity-1;
+    count = 0;
+}
+
+void PosePredictor::addSample(const PoseSample &sample) {
+    //keep history strictly increasing in time
+    if (count > 0 && sample.time <= samples[head].time) return;
+
+    head = (head+1)%capacity;
+    samples[head] = sample;
+    count = std::min(count+1,capacity);
+}
+
+const PoseSample& PosePredictor::at(int i) const {
+    return samples[(head-count+1+i+capacity)%capacity];
+}
+
+bool PosePredictor::predict(double time, PoseSample &prediction) const {
+    if (count == 0) return false;
+
+    const PoseSample &newest = samples[head];
+
+    //extrapolate at constant velocity past the newest sample
+    if (time >= newest.time) {
+        float dt = std::min(time-newest.time,max_horizon);
+        prediction = newest;
+        prediction.time = time;
+        prediction.position = newest.position + newest.linear_velocity*dt;
+
+        //integrate world frame angular velocity
+        float angle = newest.angular_velocity.norm()*dt;
+        if (angle > 0) {
+            Eigen::Quaternionf dq(Eigen::AngleAxisf(angle,newest.angular_velocity.normalized()));
+            prediction.orientation = (dq*newest.orientation).normalized();
+        }
+        return true;
+    }
+
+    //clamp to the oldest sample
+    const PoseSample &oldest = at(0);
+    if (time <= oldest.time) {
+        prediction = oldest;
+        prediction.time = time;
+        return true;
+    }
+
+    //find the bracketing pair of samples
+    int i = count-2;
+    while (i > 0 && at(i).time > time) i--;
+    const PoseSample &a = at(i);
+    const PoseSample &b = at(i+1);
+
+    //cubic Hermite interpolation of position using sampled velocities
+    float h = b.time-a.time;
+    float s = (time-a.time)/h;
+    float s2 = s*s;
+    float s3 = s2*s;
+    float h00 = 2*s3-3*s2+1;
+    float h10 = s3-2*s2+s;
+    float h01 = -2*s3+3*s2;
+    float h11 = s3-s2;
+
+    prediction.time = time;
+    prediction.position = h00*a.position + h10*h*a.linear_velocity + h01*b.position + h11*h*b.linear_velocity;
+    prediction.orientation = a.orientation.slerp(s,b.orientation);
+    prediction.linear_velocity = (1-s)*a.linear_velocity + s*b.linear_velocity;
+    prediction.angular_velocity = (1-s)*a.angular_velocity + s*b.angular_velocity;
+    return true;
+}
+
+const PoseSample& PosePredictor::getLatestSample() const {
+    return samples[head];
+}
+
+int PosePredictor::getSampleCount() const {
+    return count;
+}
+
+double PosePredictor::getMaxHorizon() const {
+    return max_horizon;
+}
@@ -0,0 +1,76 @@
+#include <predictive_trigger.hpp>
+
+PredictiveTrigger::PredictiveTrigger() : PredictiveTrigger(0.02,0.2) {}
+
+PredictiveTrigger::PredictiveTrigger(double m_lookahead, double m_min_speed) {
+    lookahead = m_lookahead;
+    min_speed = m_min_speed;
+    rearm_height = 0.005;
+    reset();
+}
+
+void PredictiveTrigger::reset() {
+    state = State::Armed;
+    fired_time = 0;
+    has_last = false;
+    last_time = 0;
+    last_height = 0;
+    last_velocity = 0;
+}
+
+TriggerResult PredictiveTrigger::update(double time, double height, double velocity) {
+    TriggerResult result;
+
+    switch (state) {
+        case State::Armed:
+            if (height <= 0) {
+                //crossed without a forecast, fire now at the interpolated crossing
+                if (has_last && last_height > 0) {
+                    double s = last_height/(last_height-height);
+                    result.action = TriggerAction::Fire;
+                    result.contact_time = last_time + s*(time-last_time);
+                    result.velocity = last_velocity + s*(velocity-last_velocity);
+                }
+                state = State::Contact;
+            }
+            else if (velocity < -min_speed && height <= -velocity*lookahead) {
+                result.action = TriggerAction::Fire;
+                result.contact_time = time + height/-velocity;
+                result.velocity = velocity;
+                fired_time = result.contact_time;
+                state = State::Fired;
+            }
+            break;
+
+        case State::Fired:
+            if (height <= 0) {
+                result.action = TriggerAction::Confirm;
+                result.contact_time = fired_time;
+                state = State::Contact;
+            }
+            else if (velocity >= 0 || time > fired_time+lookahead) {
+                result.action = TriggerAction::Cancel;
+                result.contact_time = fired_time;
+                state = State::Armed;
+            }
+            break;
+
+        case State::Contact:
+            if (height > rearm_height) state = State::Armed;
+            break;
+    }
+
+    has_last = true;
+    last_time = time;
+    last_height = height;
+    last_velocity = velocity;
+    return result;
+}
+
+void PredictiveTrigger::setLookahead(double m_lookahead) {
+    lookahead = m_lookahead;
+}
+
+double PredictiveTrigger::getLookahead() const {
+    return lookahead;
+}
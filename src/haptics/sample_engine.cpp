@@ -0,0 +1,338 @@
+#include <sample_engine.hpp>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    /// \brief reads a little endian unsigned integer
+    uint32_t readLE(const unsigned char *bytes, int n) {
+        uint32_t value = 0;
+        for (int i=0; i<n; i++) value |= uint32_t(bytes[i]) << (8*i);
+        return value;
+    }
+
+    /// \brief writes a little endian unsigned integer
+    void writeLE(std::ofstream &file, uint32_t value, int n) {
+        for (int i=0; i<n; i++) file.put(char((value >> (8*i)) & 0xFF));
+    }
+}
+
+bool loadWav(const std::string &filename, Sample &sample) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (bytes.size() < 12 || std::memcmp(&bytes[0],"RIFF",4) != 0 || std::memcmp(&bytes[8],"WAVE",4) != 0) return false;
+
+    int format = 0;
+    int channels = 0;
+    int bits = 0;
+    const unsigned char *pcm = nullptr;
+    std::size_t pcm_size = 0;
+
+    //walk the chunk list for fmt and data
+    std::size_t offset = 12;
+    while (offset+8 <= bytes.size()) {
+        const unsigned char *chunk = &bytes[offset];
+        std::size_t size = readLE(chunk+4,4);
+        std::size_t available = std::min(size,bytes.size()-offset-8);
+        if (std::memcmp(chunk,"fmt ",4) == 0 && available >= 16) {
+            format = readLE(chunk+8,2);
+            channels = readLE(chunk+10,2);
+            sample.sample_rate = readLE(chunk+12,4);
+            bits = readLE(chunk+22,2);
+
+            //WAVE_FORMAT_EXTENSIBLE keeps the real format in the sub format GUID
+            if (format == 0xFFFE && available >= 26) format = readLE(chunk+32,2);
+        }
+        else if (std::memcmp(chunk,"data",4) == 0) {
+            pcm = chunk+8;
+            pcm_size = available;
+        }
+        offset += 8+size+(size & 1);
+    }
+
+    bool pcm_format = format == 1 && (bits == 8 || bits == 16 || bits == 24 || bits == 32);
+    bool float_format = format == 3 && bits == 32;
+    if (pcm == nullptr || channels <= 0 || sample.sample_rate <= 0 || (!pcm_format && !float_format)) return false;
+
+    //decode and mix down to mono
+    int width = bits/8;
+    std::size_t frames = pcm_size/(width*channels);
+    sample.data.assign(frames,0);
+    for (std::size_t i=0; i<frames; i++) {
+        float sum = 0;
+        for (int c=0; c<channels; c++) {
+            const unsigned char *p = pcm+(i*channels+c)*width;
+            uint32_t raw = readLE(p,width);
+            float value;
+            if (float_format) std::memcpy(&value,&raw,4);
+            else if (bits == 8) value = (int(raw)-128)/128.0f;
+            else {
+                //sign extend to 32 bits then scale
+                int32_t s = int32_t(raw << (32-bits));
+                value = s/2147483648.0f;
+            }
+            sum += value;
+        }
+        sample.data[i] = sum/channels;
+    }
+    return true;
+}
+
+bool saveWav(const std::string &filename, const std::vector<float> &data, int channels, int sample_rate) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    uint32_t data_size = data.size()*2;
+    file.write("RIFF",4);
+    writeLE(file,36+data_size,4);
+    file.write("WAVEfmt ",8);
+    writeLE(file,16,4);
+    writeLE(file,1,2);
+    writeLE(file,channels,2);
+    writeLE(file,sample_rate,4);
+    writeLE(file,sample_rate*channels*2,4);
+    writeLE(file,channels*2,2);
+    writeLE(file,16,2);
+    file.write("data",4);
+    writeLE(file,data_size,4);
+    for (float value : data) {
+        int16_t s = int16_t(std::max(-1.0f,std::min(value,1.0f))*32767);
+        writeLE(file,uint16_t(s),2);
+    }
+    return file.good();
+}
+
+void resample(Sample &sample, int sample_rate) {
+    if (sample.sample_rate == sample_rate || sample.sample_rate <= 0 || sample.data.empty()) return;
+
+    double ratio = double(sample.sample_rate)/sample_rate;
+    std::size_t frames = std::size_t(sample.data.size()/ratio);
+    std::vector<float> data(frames);
+    for (std::size_t i=0; i<frames; i++) {
+        double x = i*ratio;
+        std::size_t j = std::size_t(x);
+        double s = x-j;
+        float next = j+1 < sample.data.size() ? sample.data[j+1] : sample.data[j];
+        data[i] = (1-s)*sample.data[j] + s*next;
+    }
+    sample.data.swap(data);
+    sample.sample_rate = sample_rate;
+}
+
+SampleEngine::SampleEngine() : SampleEngine(48000) {}
+
+SampleEngine::SampleEngine(int m_sample_rate) : dropped(0) {
+    sample_rate = m_sample_rate;
+    voice_count = 0;
+    pending_count = 0;
+    latency = 0.02;
+    clock_base = 0;
+    frame_count = 0;
+    late = 0;
+    cancelled = 0;
+}
+
+bool SampleEngine::loadSample(int id, const std::string &filename) {
+    if (id < 0) return false;
+
+    Sample sample;
+    if (!loadWav(filename,sample)) {
+        std::cerr << "Failed to load sample " << filename << std::endl;
+        return false;
+    }
+    resample(sample,sample_rate);
+
+    if (id >= (int)samples.size()) samples.resize(id+1);
+    samples[id] = std::move(sample);
+    return true;
+}
+
+bool SampleEngine::loadDrumKit(const std::string &directory) {
+    //ids match the drums in drumkit_main and the routes in drum_kit.pd
+    bool snare = loadSample(0,directory+"/snare.wav");
+    bool kick = loadSample(1,directory+"/kick.wav");
+    bool hat = loadSample(2,directory+"/hi_hat.wav");
+    return snare && kick && hat;
+}
+
+void SampleEngine::setEnvelope(const AdsrEnvelope &m_envelope) {
+    envelope = m_envelope;
+}
+
+void SampleEngine::setLatency(double m_latency) {
+    latency = m_latency;
+}
+
+void SampleEngine::send(const HitEvent &hit) {
+    if (!queue.push(hit)) dropped++;
+}
+
+void SampleEngine::cancel(const HitEvent &hit) {
+    HitEvent withdrawal = hit;
+    withdrawal.cancel = true;
+    if (!queue.push(withdrawal)) dropped++;
+}
+
+void SampleEngine::enterStage(Voice &voice, Stage stage) {
+    //linear ramps like line~ in adsr.pd, at least one sample long
+    auto ramp = [this](double from, double to, double ms) {
+        double n = std::max(1.0,ms*1e-3*sample_rate);
+        return (to-from)/n;
+    };
+
+    voice.stage = stage;
+    switch (stage) {
+        case Stage::Attack: voice.step = ramp(voice.gain,voice.peak,envelope.attack); break;
+        case Stage::Decay: voice.step = ramp(voice.peak,voice.sustain,envelope.decay); break;
+        case Stage::Release: voice.step = ramp(voice.gain,0,envelope.release); break;
+        default: voice.step = 0; break;
+    }
+}
+
+void SampleEngine::startVoice(const HitEvent &hit) {
+    if (hit.id < 0 || hit.id >= (int)samples.size() || samples[hit.id].data.empty()) return;
+
+    //a new hit chokes the previous one on the same drum, like retriggering the Pure Data sampler
+    for (auto &voice : voices) {
+        if (voice.stage != Stage::Idle && voice.stage != Stage::Release && voice.id == hit.id) enterStage(voice,Stage::Release);
+    }
+
+    //take a free voice, otherwise steal the oldest
+    Voice *voice = &voices[0];
+    for (auto &v : voices) {
+        if (v.stage == Stage::Idle) {
+            voice = &v;
+            break;
+        }
+        if (v.age < voice->age) voice = &v;
+    }
+
+    voice->sample = &samples[hit.id];
+    voice->id = hit.id;
+    voice->position = 0;
+    voice->gain = 0;
+    voice->peak = hit.level;
+    voice->sustain = hit.level*hit.sustain*0.01;
+    voice->age = voice_count++;
+    enterStage(*voice,Stage::Attack);
+}
+
+void SampleEngine::render(float *out, int frames) {
+    const double resync_threshold = 0.005;  //clock error treated as an underrun rather than jitter [s]
+    const double gain = 0.01;               //clock smoothing gain
+
+    //the frame count is the steady timeline, the steady clock only corrects its drift
+    double now = steadyTime();
+    double error = now-(clock_base+double(frame_count)/sample_rate);
+    if (frame_count == 0 || std::abs(error) > resync_threshold) clock_base += error;
+    else clock_base += gain*error;
+
+    render(out,frames,clock_base+double(frame_count)/sample_rate);
+    frame_count += frames;
+}
+
+void SampleEngine::render(float *out, int frames, double time) {
+    HitEvent hit;
+    while (pending_count < (int)pending.size() && queue.pop(hit)) {
+        if (!hit.cancel) {
+            pending[pending_count++] = hit;
+            continue;
+        }
+
+        //too late if the hit already started
+        for (int i=0; i<pending_count; i++) {
+            if (pending[i].id == hit.id && pending[i].time == hit.time) {
+                pending[i] = pending[--pending_count];
+                cancelled++;
+                break;
+            }
+        }
+    }
+
+    std::fill(out,out+frames*channels,0.0f);
+
+    //mix up to each onset in this block in order, then start the voice
+    int frame = 0;
+    while (true) {
+        int next = -1;
+        int start = frames;
+        for (int i=0; i<pending_count; i++) {
+            //untimed hits start immediately
+            double offset = pending[i].time > 0 ? (pending[i].time+latency-time)*sample_rate : 0;
+            int f = offset < frame ? frame : (offset < frames ? int(offset) : frames);
+            if (f < start) {
+                start = f;
+                next = i;
+            }
+        }
+        if (next < 0) break;
+
+        mix(out+frame*channels,start-frame);
+        frame = start;
+
+        if (pending[next].time > 0 && (pending[next].time+latency-time)*sample_rate < frame-1) late++;
+        startVoice(pending[next]);
+        pending[next] = pending[--pending_count];
+    }
+    mix(out+frame*channels,frames-frame);
+}
+
+void SampleEngine::mix(float *out, int frames) {
+    for (auto &voice : voices) {
+        if (voice.stage == Stage::Idle) continue;
+
+        const std::vector<float> &data = voice.sample->data;
+        for (int i=0; i<frames; i++) {
+            if (voice.position >= data.size()) {
+                voice.stage = Stage::Idle;
+                break;
+            }
+
+            //advance envelope
+            voice.gain += voice.step;
+            if (voice.stage == Stage::Attack && voice.gain >= voice.peak) {
+                voice.gain = voice.peak;
+                enterStage(voice,Stage::Decay);
+            }
+            else if (voice.stage == Stage::Decay && (voice.step <= 0 ? voice.gain <= voice.sustain : voice.gain >= voice.sustain)) {
+                voice.gain = voice.sustain;
+                enterStage(voice,Stage::Sustain);
+            }
+            else if (voice.stage == Stage::Release && voice.gain <= 0) {
+                voice.stage = Stage::Idle;
+                break;
+            }
+
+            float value = voice.gain*data[voice.position++];
+            for (int c=0; c<channels; c++) out[i*channels+c] += value;
+        }
+    }
+}
+
+int SampleEngine::getSampleRate() const {
+    return sample_rate;
+}
+
+int SampleEngine::getActiveVoiceCount() const {
+    int count = 0;
+    for (const auto &voice : voices) {
+        if (voice.stage != Stage::Idle) count++;
+    }
+    return count;
+}
+
+int SampleEngine::getDroppedCount() const {
+    return dropped.load();
+}
+
+int SampleEngine::getLateCount() const {
+    return late;
+}
+
+int SampleEngine::getCancelledCount() const {
+    return cancelled;
+}
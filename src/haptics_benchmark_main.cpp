@@ -0,0 +1,133 @@
+#include <haptic_engine.hpp>
+#include <force_lut.hpp>
+#include <iostream>
+#include <chrono>
+#include <string>
+
+/// \brief builds a scene with a mix of every primitive type
+/// \param n - number of primitives
+/// \returns scene
+HapticScene buildScene(int n) {
+    HapticScene scene(0.5);
+    for (int i=0; i<n; i++) {
+        double offset = 0.01*i;
+        switch (i%6) {
+            case 0: {
+                SpringWall wall;
+                wall.position = offset;
+                wall.stiffness = 600;
+                wall.direction = -1;
+                wall.quadratic = true;
+                scene.add(wall);
+                break;
+            }
+            case 1: {
+                Damper damper;
+                damper.damping = 0.01;
+                scene.add(damper);
+                break;
+            }
+            case 2: {
+                Detent detent;
+                detent.center = offset;
+                detent.width = 0.02;
+                detent.strength = 0.1;
+                scene.add(detent);
+                break;
+            }
+            case 3: {
+                Friction friction;
+                friction.level = 0.05;
+                scene.add(friction);
+                break;
+            }
+            case 4: {
+                Texture texture;
+                texture.lower = -offset;
+                texture.upper = offset;
+                texture.period = 0.005;
+                texture.amplitude = 0.05;
+                scene.add(texture);
+                break;
+            }
+            default: {
+                ViscousField field;
+                field.lower = -offset;
+                field.upper = offset;
+                field.damping = 0.2;
+                scene.add(field);
+                break;
+            }
+        }
+    }
+    return scene;
+}
+
+int main(int argc, char* argv[]) {
+
+    int ticks = 1000000;
+
+    //Parse command line arguements
+    if (argc == 2) {
+        ticks = std::stoi(argv[1]);
+    }
+    else if (argc != 1) {
+        std::cout << "Invalid number of command line arguements" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Primitives," << " Ticks," << " Time per tick (ns)" << "\n";
+
+    //accumulate forces so the evaluation is not optimized away
+    double sink = 0;
+
+    for (int n=1; n<=256; n*=2) {
+        HapticScene scene = buildScene(n);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i=0; i<ticks; i++) {
+            //sweep the position through the scene so every branch is exercised
+            double x = 0.1*((i%2000)/1000.0-1);
+            double v = (i%2000) < 1000 ? 0.2 : -0.2;
+            sink += scene.evaluate(x,v);
+        }
+        std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+
+        double ns = std::chrono::duration_cast<std::chrono::duration<double,std::nano>>(stop-start).count();
+        std::cout << n << "," << ticks << "," << ns/ticks << "\n";
+    }
+
+    //compare analytic surface laws with tabulated ones over the drum penetration range
+    const double k = 600;           //drum spring constant [N/m]
+    const double depth = 0.1;       //tabulated penetration range [m]
+    auto law = [k](double d) { return std::abs(k*std::pow(d,2.5)); };
+    ForceLookupTable linear_lut(law,0,depth,256,Interpolation::Linear);
+    ForceLookupTable cubic_lut(law,0,depth,256,Interpolation::Cubic);
+
+    std::cout << "\n" << "Force model," << " Time per evaluation (ns)," << " Max error (N)" << "\n";
+
+    auto benchmark = [&](const std::string &name, auto &&model, auto &&reference) {
+        double max_error = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i=0; i<ticks; i++) {
+            double d = depth*(i%1000)/1000.0;
+            sink += model(d);
+        }
+        std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+        for (int i=0; i<1000; i++) {
+            double d = depth*(i+0.37)/1000.0;
+            max_error = std::max(max_error,std::abs(model(d)-reference(d)));
+        }
+        double ns = std::chrono::duration_cast<std::chrono::duration<double,std::nano>>(stop-start).count();
+        std::cout << name << "," << ns/ticks << "," << max_error << "\n";
+    };
+
+    auto quadratic = [k](double d) { return std::abs(k*std::pow(d,2)); };
+    benchmark("analytic quadratic (pow)",quadratic,quadratic);
+    benchmark("analytic d^2.5 (pow)",law,law);
+    benchmark("lut linear d^2.5",[&linear_lut](double d) { return linear_lut.evaluate(d); },law);
+    benchmark("lut cubic d^2.5",[&cubic_lut](double d) { return cubic_lut.evaluate(d); },law);
+
+    std::cout << "Checksum: " << sink << std::endl;
+    return 0;
+}
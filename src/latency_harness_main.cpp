@@ -0,0 +1,100 @@
+#include <haptics.hpp>
+#include <motor_communication.hpp>
+#include <latency_probe.hpp>
+#include <osc_output.hpp>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <chrono>
+
+int main(int argc, char* argv[]) {
+
+    double alpha = 0.5;                         //exponential filter alpha, as in drumkit
+
+    //Snare Constants, as in drumkit
+    double snare_length = 0.4;                      //length of drum [m]
+    double snare_width = 0.4;                       //width of drum [m]
+    double snare_k = 600;                           //spring constant [N/m]
+    std::pair<double,double> snare_sustain_limits{0,500}; //susatin [%]
+    std::pair<double,double> snare_level_limits{0,3};     //amplifier
+    Eigen::Vector3f snare_center;                   //center coordinates of drum [m]
+    snare_center << 0, 0, 0.1;
+
+    std::string filename;
+    std::string portname;
+    std::string output_mode = "tcp";
+
+    //Parse command line arguements
+    if (argc == 3) {
+        filename = argv[1];
+        portname = argv[2];
+    }
+    else if (argc == 4) {
+        filename = argv[1];
+        portname = argv[2];
+        output_mode = argv[3];
+    }
+    else {
+        std::cout << "Usage: latency_harness <recording.csv> <odrive port> [tcp|udp|stdout|osc]" << std::endl;
+        return 1;
+    }
+
+    std::vector<double> times;
+    std::vector<double> heights;
+    if (!readHeightRecording(filename,times,heights)) {
+        std::cout << "Failed to read " << filename << std::endl;
+        return 1;
+    }
+
+    //Sound output, stamped as hits are handed over
+    std::unique_ptr<HitOutput> output;
+    if (output_mode == "tcp") output = std::make_unique<FudiClient>("127.0.0.1",8080,FudiProtocol::TCP);
+    else if (output_mode == "udp") output = std::make_unique<FudiClient>("127.0.0.1",8080,FudiProtocol::UDP);
+    else if (output_mode == "stdout") output = std::make_unique<StdoutOutput>();
+    else if (output_mode == "osc") output = std::make_unique<OscOutput>("127.0.0.1",9000);
+    else {
+        std::cout << "Unknown sound output " << output_mode << std::endl;
+        return 1;
+    }
+    LatencyProbe probe;
+    ProbedOutput probed_output(*output,probe);
+
+    Drum snare(0,snare_center,snare_length,snare_width,snare_k,snare_sustain_limits,snare_level_limits);
+    snare.setOutput(&probed_output);
+
+    //Odrive, or any serial port standing in for one
+    Odrive odrive(portname, 115200);
+
+    ExponentialFilter ef = ExponentialFilter(3,alpha);
+    DrumstickState previous;
+
+    //replay the recording at its own pace so every run sees the same timing
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i=0; i<times.size(); i++) {
+        std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(times[i]-times[0])));
+
+        //the recorded pose arrives now
+        double pose_time = steadyTime();
+        probe.beginSample(pose_time);
+
+        std::vector<double> drumstick_pos{0,0,heights[i]};
+        ef.filterData(drumstick_pos);
+        DrumstickState current;
+        current.time = pose_time;
+        current.position = ef.getForcastFloat();
+        if (i > 0) current.velocity = (current.position-previous.position)/(current.time-previous.time);
+        else previous = current;
+        probe.stamp(LatencyStage::Filter);
+
+        double torque = snare.update(previous,current);
+        previous = current;
+        probe.stamp(LatencyStage::Update);
+
+        odrive.sendTorqueCommand(0,torque);
+        probe.stamp(LatencyStage::Torque);
+    }
+
+    std::cout << "\n" << times.size() << " poses replayed from " << filename << "\n";
+    probe.report(std::cout);
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <pose_prediction.hpp>
+#include <haptics.hpp>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+/// \brief linearly interpolates the recording at a given time
+double interpolate(const std::vector<double> &times, const std::vector<double> &values, double time) {
+    auto it = std::upper_bound(times.begin(),times.end(),time);
+    if (it == times.begin()) return values.front();
+    if (it == times.end()) return values.back();
+    int i = it-times.begin();
+    double s = (time-times[i-1])/(times[i]-times[i-1]);
+    return (1-s)*values[i-1] + s*values[i];
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string filename;
+    double max_horizon_ms = 30;
+    double alpha = 1;       //velocity filter alpha, 1 disables filtering
+
+    //Parse command line arguements
+    if (argc == 2) {
+        filename = argv[1];
+    }
+    else if (argc == 3) {
+        filename = argv[1];
+        max_horizon_ms = std::stod(argv[2]);
+    }
+    else if (argc == 4) {
+        filename = argv[1];
+        max_horizon_ms = std::stod(argv[2]);
+        alpha = std::stod(argv[3]);
+    }
+    else {
+        std::cout << "Usage: pose_prediction_eval <recording.csv> [max horizon ms] [velocity filter alpha]" << std::endl;
+        return 1;
+    }
+
+    std::vector<double> times;
+    std::vector<double> heights;
+    if (!readHeightRecording(filename,times,heights)) {
+        std::cout << "Failed to read " << filename << std::endl;
+        return 1;
+    }
+
+    //recordings only contain position so estimate velocity causally with a lowpass filtered backward difference
+    std::vector<double> velocities = filteredVelocity(times,heights,alpha);
+
+    std::cout << "Horizon (ms)," << " Hold RMS (mm)," << " Hold Max (mm)," << " Predicted RMS (mm)," << " Predicted Max (mm)," << " Samples" << "\n";
+
+    for (double horizon_ms=0; horizon_ms<=max_horizon_ms; horizon_ms+=5) {
+        double horizon = horizon_ms/1000;
+
+        //never clamp the horizon being evaluated
+        PosePredictor predictor(horizon);
+        double hold_sq = 0, hold_max = 0;
+        double pred_sq = 0, pred_max = 0;
+        int n = 0;
+
+        for (int i=0; i<times.size(); i++) {
+            PoseSample sample;
+            sample.time = times[i];
+            sample.position << 0, 0, heights[i];
+            sample.linear_velocity << 0, 0, velocities[i];
+            predictor.addSample(sample);
+
+            double query = times[i]+horizon;
+            if (i < 1 || query > times.back()) continue;
+
+            PoseSample prediction;
+            predictor.predict(query,prediction);
+            double truth = interpolate(times,heights,query);
+
+            double hold_error = std::abs(heights[i]-truth)*1000;
+            double pred_error = std::abs(prediction.position[2]-truth)*1000;
+            hold_sq += hold_error*hold_error;
+            pred_sq += pred_error*pred_error;
+            hold_max = std::max(hold_max,hold_error);
+            pred_max = std::max(pred_max,pred_error);
+            n++;
+        }
+
+        if (n == 0) continue;
+        std::cout << horizon_ms << "," << std::sqrt(hold_sq/n) << "," << hold_max << "," << std::sqrt(pred_sq/n) << "," << pred_max << "," << n << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include "pch.h"
+#include "common.h"
+#include "options.h"
+#include "graphicsplugin.h"
+#include "xr_linear.h"
+#include <iostream>
+#include <array>
+#include <chrono>
+#include <string>
+#include <cmath>
+
+/// \brief fills cubes with an n cube grid in front of the viewer, spinning with the frame index
+/// \param cubes - cube array, must hold n
+/// \param n - number of cubes
+/// \param frame - frame index
+void buildCubes(FrameArray<Cube> &cubes, int n, int frame) {
+    int side = (int)std::ceil(std::sqrt((double)n));
+    float spacing = 2.0f/side;
+    XrVector3f axis{0,1,0};
+    for (int i=0; i<n; i++) {
+        Cube cube;
+        cube.Pose.position = {-1.0f + spacing*(i%side + 0.5f), -1.0f + spacing*(i/side + 0.5f), -2.0f};
+        XrQuaternionf_CreateFromAxisAngle(&cube.Pose.orientation, &axis, 0.01f*(frame + i));
+        cube.Scale = {0.4f*spacing, 0.4f*spacing, 0.4f*spacing};
+        cubes.push_back(cube);
+    }
+}
+
+/// \brief value at fraction p of sorted samples
+double percentile(std::vector<double> samples, double p) {
+    if (samples.empty()) return 0;
+    std::sort(samples.begin(),samples.end());
+    return samples[(size_t)(p*(samples.size()-1))];
+}
+
+/// \brief mean of samples
+double mean(const std::vector<double> &samples) {
+    if (samples.empty()) return 0;
+    double sum = 0;
+    for (double s : samples) sum += s;
+    return sum/samples.size();
+}
+
+int main(int argc, char* argv[]) {
+
+    int cube_count = 1000;
+    int frame_count = 1000;
+    uint32_t width = 1440;
+    uint32_t height = 1600;
+    bool multiview = true;
+    const int warmup = 10;            //frames left out of the results, they pay for pipeline creation and first touches
+    const uint32_t image_count = 3;   //offscreen images cycled through, as a runtime's swapchain would
+
+    //Parse command line arguements
+    if (argc > 6) {
+        std::cout << "Invalid number of command line arguements" << std::endl;
+        return 1;
+    }
+    if (argc > 1) cube_count = std::stoi(argv[1]);
+    if (argc > 2) frame_count = std::stoi(argv[2]);
+    if (argc > 3) width = (uint32_t)std::stoul(argv[3]);
+    if (argc > 4) height = (uint32_t)std::stoul(argv[4]);
+    if (argc > 5) multiview = std::stoi(argv[5]) != 0;
+
+    std::shared_ptr<Options> options = std::make_shared<Options>();
+    options->Multiview = multiview;
+    options->PipelineCachePath = "";  //every run pays for pipeline creation in the warmup frames, and leaves no cache file behind
+
+    std::shared_ptr<IGraphicsPlugin> graphicsPlugin = CreateGraphicsPlugin_Vulkan(options, nullptr);
+    graphicsPlugin->InitializeHeadlessDevice();
+    if (multiview && !graphicsPlugin->SupportsMultiview()) {
+        std::cout << "Device does not support multiview, rendering each eye in its own pass" << std::endl;
+        multiview = false;
+    }
+
+    //one array image per frame for multiview, otherwise one image per eye
+    XrSwapchainCreateInfo swapchainCreateInfo{XR_TYPE_SWAPCHAIN_CREATE_INFO};
+    swapchainCreateInfo.usageFlags = XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+    swapchainCreateInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+    swapchainCreateInfo.sampleCount = 1;
+    swapchainCreateInfo.width = width;
+    swapchainCreateInfo.height = height;
+    swapchainCreateInfo.faceCount = 1;
+    swapchainCreateInfo.arraySize = multiview ? 2 : 1;
+    swapchainCreateInfo.mipCount = 1;
+    std::vector<std::vector<XrSwapchainImageBaseHeader*>> images;
+    for (int eye=0; eye<(multiview ? 1 : 2); eye++) {
+        images.push_back(graphicsPlugin->AllocateOffscreenImages(image_count, swapchainCreateInfo));
+    }
+
+    //eyes 64 mm apart with a 90 degree field of view
+    std::array<XrCompositionLayerProjectionView,2> views;
+    for (uint32_t eye=0; eye<2; eye++) {
+        views[eye] = {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW};
+        views[eye].pose.orientation = {0,0,0,1};
+        views[eye].pose.position = {eye == 0 ? -0.032f : 0.032f, 0, 0};
+        views[eye].fov = {-0.785398f, 0.785398f, 0.785398f, -0.785398f};
+        views[eye].subImage.imageRect = {{0,0},{(int32_t)width,(int32_t)height}};
+        views[eye].subImage.imageArrayIndex = multiview ? eye : 0;
+    }
+
+    FrameArena arena(cube_count*sizeof(Cube) + 64);
+    std::vector<double> wait_ms, record_ms, submit_ms, cpu_ms;
+    std::vector<double> gpu_ms(frame_count, 0);
+    std::vector<bool> gpu_timed(frame_count, false);   //frames at least one pass has a GPU time for
+    std::vector<GpuPassTiming> passes(64);
+
+    //GPU timings arrive a few frames late, add each to the frame that recorded it
+    auto collect = [&]() {
+        size_t count;
+        while ((count = graphicsPlugin->CollectGpuTimings(passes.data(),passes.size())) > 0) {
+            for (size_t i=0; i<count; i++) {
+                if (passes[i].frame >= 1 && passes[i].frame <= (uint64_t)frame_count) {
+                    gpu_ms[passes[i].frame-1] += passes[i].durationMs;
+                    gpu_timed[passes[i].frame-1] = true;
+                }
+            }
+        }
+    };
+
+    for (int frame=0; frame<frame_count; frame++) {
+        arena.reset();
+        FrameArray<Cube> cubes(arena,cube_count);
+        buildCubes(cubes,cube_count,frame);
+
+        graphicsPlugin->BeginFrameTiming(frame+1);
+        PassCpuTiming total{0,0,0};
+        auto start = std::chrono::steady_clock::now();
+        if (multiview) {
+            graphicsPlugin->RenderMultiview(views.data(),2,images[0][frame%image_count],VK_FORMAT_R8G8B8A8_SRGB,cubes);
+            total = graphicsPlugin->GetLastPassCpuTiming();
+        }
+        else {
+            for (int eye=0; eye<2; eye++) {
+                graphicsPlugin->RenderView(views[eye],images[eye][frame%image_count],VK_FORMAT_R8G8B8A8_SRGB,cubes);
+                PassCpuTiming pass = graphicsPlugin->GetLastPassCpuTiming();
+                total.waitMs += pass.waitMs;
+                total.recordMs += pass.recordMs;
+                total.submitMs += pass.submitMs;
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        collect();
+
+        if (frame >= warmup) {
+            wait_ms.push_back(total.waitMs);
+            record_ms.push_back(total.recordMs);
+            submit_ms.push_back(total.submitMs);
+            cpu_ms.push_back(std::chrono::duration<double,std::milli>(end-start).count());
+        }
+    }
+    graphicsPlugin->WaitIdle();
+    collect();
+
+    //only frames that were timed, a device without timestamp queries times none
+    std::vector<double> gpu_results;
+    for (int frame=std::min(warmup,frame_count); frame<frame_count; frame++) {
+        if (gpu_timed[frame]) gpu_results.push_back(gpu_ms[frame]);
+    }
+
+    std::cout << "Cubes," << " Frames," << " Width," << " Height," << " Multiview,"
+              << " Wait mean (ms)," << " Record mean (ms)," << " Submit mean (ms)," << " CPU mean (ms)," << " CPU p99 (ms),"
+              << " GPU mean (ms)," << " GPU p99 (ms)" << "\n";
+    std::cout << cube_count << ", " << frame_count << ", " << width << ", " << height << ", " << multiview << ", "
+              << mean(wait_ms) << ", " << mean(record_ms) << ", " << mean(submit_ms) << ", " << mean(cpu_ms) << ", " << percentile(cpu_ms,0.99) << ", ";
+    if (gpu_results.empty()) std::cout << "n/a, n/a\n";
+    else std::cout << mean(gpu_results) << ", " << percentile(gpu_results,0.99) << "\n";
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <predictive_trigger.hpp>
+#include <haptics.hpp>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+/// \brief finds the recorded strikes, downward crossings of the plane with the trigger's rearm hysteresis
+/// \param times - sample times [s]
+/// \param heights - sample heights above the plane [m]
+/// \returns interpolated crossing times [s]
+std::vector<double> findStrikes(const std::vector<double> &times, const std::vector<double> &heights) {
+    const double rearm_height = 0.005;
+    std::vector<double> strikes;
+    bool armed = heights[0] > 0;
+    for (int i=1; i<times.size(); i++) {
+        if (armed && heights[i-1] > 0 && heights[i] <= 0) {
+            double s = heights[i-1]/(heights[i-1]-heights[i]);
+            strikes.push_back(times[i-1] + s*(times[i]-times[i-1]));
+            armed = false;
+        }
+        else if (heights[i] > rearm_height) armed = true;
+    }
+    return strikes;
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string filename;
+    double plane = 0;           //drum plane height [m]
+    double alpha = 1;           //velocity filter alpha, 1 disables filtering
+    double match_window = 0.1;  //largest timing error still counted as the same strike [s]
+
+    //Parse command line arguements
+    if (argc == 2) {
+        filename = argv[1];
+    }
+    else if (argc == 3) {
+        filename = argv[1];
+        plane = std::stod(argv[2]);
+    }
+    else if (argc == 4) {
+        filename = argv[1];
+        plane = std::stod(argv[2]);
+        alpha = std::stod(argv[3]);
+    }
+    else {
+        std::cout << "Usage: trigger_eval <recording.csv> [plane height m] [velocity filter alpha]" << std::endl;
+        return 1;
+    }
+
+    std::vector<double> times;
+    std::vector<double> heights;
+    if (!readHeightRecording(filename,times,heights)) {
+        std::cout << "Failed to read " << filename << std::endl;
+        return 1;
+    }
+    for (auto &h : heights) h -= plane;
+
+    std::vector<double> strikes = findStrikes(times,heights);
+    if (strikes.empty()) {
+        std::cout << "No strikes through the plane at " << plane << " m" << std::endl;
+        return 1;
+    }
+
+    //recordings only contain position so estimate velocity causally with a lowpass filtered backward difference
+    std::vector<double> velocities = filteredVelocity(times,heights,alpha);
+
+    std::cout << strikes.size() << " recorded strikes" << "\n";
+    std::cout << "Lookahead (ms)," << " Fired," << " Hits," << " Missed," << " False," << " False cancelled," << " Hits cancelled,"
+              << " Timing error mean (ms)," << " Timing error std (ms)," << " Timing error max (ms)," << " Lead mean (ms)" << "\n";
+
+    for (double lookahead_ms=0; lookahead_ms<=50; lookahead_ms+=10) {
+        PredictiveTrigger trigger(lookahead_ms/1000,0.2);
+        std::vector<bool> matched(strikes.size(),false);
+        int fired = 0, hits = 0, false_triggers = 0, false_cancelled = 0, hits_cancelled = 0;
+        double error_sum = 0, error_sq = 0, error_max = 0, lead_sum = 0;
+        int last_strike = -1;   //strike matched by the most recent fire, -1 if it was false
+
+        for (int i=0; i<times.size(); i++) {
+            TriggerResult result = trigger.update(times[i],heights[i],velocities[i]);
+
+            if (result.action == TriggerAction::Fire) {
+                fired++;
+
+                //match to the closest unmatched recorded strike
+                last_strike = -1;
+                double best = match_window;
+                for (int j=0; j<strikes.size(); j++) {
+                    double error = std::abs(result.contact_time-strikes[j]);
+                    if (!matched[j] && error < best) {
+                        best = error;
+                        last_strike = j;
+                    }
+                }
+
+                if (last_strike < 0) {
+                    false_triggers++;
+                    continue;
+                }
+                matched[last_strike] = true;
+                hits++;
+
+                double error = (result.contact_time-strikes[last_strike])*1000;
+                error_sum += error;
+                error_sq += error*error;
+                error_max = std::max(error_max,std::abs(error));
+                lead_sum += (strikes[last_strike]-times[i])*1000;
+            }
+            else if (result.action == TriggerAction::Cancel) {
+                if (last_strike < 0) false_cancelled++;
+                else hits_cancelled++;
+            }
+        }
+
+        double mean = hits > 0 ? error_sum/hits : 0;
+        double std_dev = hits > 0 ? std::sqrt(std::max(0.0,error_sq/hits-mean*mean)) : 0;
+        std::cout << lookahead_ms << "," << fired << "," << hits << "," << strikes.size()-hits << "," << false_triggers << "," << false_cancelled << "," << hits_cancelled << ","
+                  << mean << "," << std_dev << "," << error_max << "," << (hits > 0 ? lead_sum/hits : 0) << "\n";
+    }
+
+    return 0;
+}
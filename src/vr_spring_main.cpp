@@ -8,6 +8,8 @@
 #include <fstream>
 #include <Eigen/Geometry>
 #include "haptics.hpp"
+#include "haptic_engine.hpp"
+#include <atomic>
 
 int main(int argc, char* argv[]) {
 
@@ -17,6 +19,9 @@ int main(int argc, char* argv[]) {
 
     //Controller
     int hand = Side::RIGHT;
+    double tracking_rate = 0;       //controller tracking thread rate [Hz], 0 samples the controller once per rendered frame
+    std::string tracking;           //controller source: "headless", "replay", a csv file to replay, or empty to render
+    bool replay_real_time = true;   //hand out replayed frames at the display rate, false replays as fast as the loop runs
 
     //logging
     std::string filename;
@@ -37,14 +42,38 @@ int main(int argc, char* argv[]) {
         portname = argv[2];
         loggingEnabled = true;
     }
+    else if (argc == 4) {
+        filename = argv[1];
+        portname = argv[2];
+        loggingEnabled = true;
+        tracking = argv[3];
+    }
+    else if (argc == 5) {
+        filename = argv[1];
+        portname = argv[2];
+        loggingEnabled = true;
+        tracking = argv[3];
+        tracking_rate = std::stod(argv[4]);
+    }
+    else if (argc == 6) {
+        filename = argv[1];
+        portname = argv[2];
+        loggingEnabled = true;
+        tracking = argv[3];
+        tracking_rate = std::stod(argv[4]);
+        replay_real_time = std::stoi(argv[5]) != 0;
+    }
     else {
         std::cout << "Invalid number of command line arguements" << std::endl;
         return 1;
     }
 
-    //Odrive setup
-    Odrive odrive(portname, 115200);
-    odrive.zeroEncoderPosition(0);
+    //Odrive setup, "none" runs the spring without a motor, logging 0 current and encoder angle
+    std::unique_ptr<Odrive> odrive;
+    if (portname != "none") {
+        odrive = std::make_unique<Odrive>(portname, 115200);
+        odrive->zeroEncoderPosition(0);
+    }
 
 
     // Set graphics plugin, VR form factor, and VR view configuration
@@ -52,6 +81,10 @@ int main(int argc, char* argv[]) {
     options->GraphicsPlugin = "Vulkan2";
     options->FormFactor = "Hmd";
     options->ViewConfiguration = "Stereo";
+    options->Headless = tracking == "headless";
+    options->Replay = !tracking.empty() && !options->Headless;
+    if (options->Replay && tracking != "replay") options->ReplayFile = tracking;
+    options->ReplayRealTime = replay_real_time;
 
     bool requestRestart = false;
     do {
@@ -61,8 +94,8 @@ int main(int argc, char* argv[]) {
         // Create graphics API implementation.
         std::shared_ptr<IGraphicsPlugin> graphicsPlugin = CreateGraphicsPlugin_Vulkan(options, platformPlugin);
 
-        // Initialize the OpenXR program.
-        std::shared_ptr<IOpenXrProgram> program = CreateOpenXrProgram(options, platformPlugin, graphicsPlugin);
+        // Initialize the OpenXR program, or the replay standing in for it.
+        std::shared_ptr<IOpenXrProgram> program = options->Replay ? CreateReplayProgram(options) : CreateOpenXrProgram(options, platformPlugin, graphicsPlugin);
 
         program->CreateInstance();
         program->InitializeSystem();
@@ -73,6 +106,15 @@ int main(int argc, char* argv[]) {
         double k = 0.4;   //[Nm/deg]
         double torque = 0;
 
+        //spring engaged between 0 and 90 degrees
+        SpringWall spring;
+        spring.position = 0;
+        spring.stiffness = k;
+        spring.range = 90;
+        spring.max_force = 0.5;
+        HapticScene scene;
+        scene.add(spring);
+
         if (loggingEnabled) {    
             datafile.open(filename);
             datafile << "Time (s)" << "," << " Current (A)" << "," << " Torque (Nm)" << "," << " VR Angle (degrees)" << "," << "Encoder Angle (degrees)" << "," << " K = " << k  << " (N/deg)" <<"\n";
@@ -81,6 +123,63 @@ int main(int argc, char* argv[]) {
         //start timer
         std::chrono::steady_clock::time_point program_start = std::chrono::steady_clock::now();
 
+        //Haptic loop for one controller sample
+        auto processController = [&](const XrSpaceLocation& pos) {
+            //convert openXR types to Eigen
+            Eigen::Quaternion<float,Eigen::AutoAlign> controller_orientation(pos.pose.orientation.w,pos.pose.orientation.x,pos.pose.orientation.y,pos.pose.orientation.z);
+            Eigen::Vector3f controller_position;
+            controller_position << pos.pose.position.x, pos.pose.position.y, pos.pose.position.z;
+
+            //create Rotate identity matrix by quaternion
+            Eigen::Transform<float,3,Eigen::Affine> Twc;
+            Twc.setIdentity();
+            Twc.rotate(controller_orientation);
+
+            //compute rotation about y axis in degrees
+            float ang = atan2(Twc.rotation()(0,0),Twc.rotation()(2,0))*(180/geometry::PI);
+
+            //get encoder data and motor current
+            double theta = 0;
+            double current = 0;
+            if (odrive) {
+                odrive->updateEncoderReadings(0);
+                theta = odrive->getEncoderPosition()*360;
+                odrive->updateMotorCurrent(0);
+                current = odrive->getCurrent();
+            }
+
+            //calculate torque and command motor
+            double command = scene.evaluate(ang,0);
+            torque = std::abs(command);
+            if (odrive) odrive->sendTorqueCommand(0,command);
+
+            //track time
+            std::chrono::steady_clock::time_point loop_stop = std::chrono::steady_clock::now();
+            double time_stamp = std::chrono::duration_cast<std::chrono::duration<double>>(loop_stop-program_start).count();
+
+             //write to csv
+            if (loggingEnabled) {
+                datafile << time_stamp << "," << current << "," << torque << "," << ang << "," << theta << "\n";
+            }
+        };
+
+        //Run the haptic loop on every tracked sample, separate from rendering
+        std::atomic<bool> haptics_running{true};
+        std::thread haptic_thread;
+        if (tracking_rate > 0) {
+            program->startTracking(tracking_rate);
+            haptic_thread = std::thread([&]() {
+                uint64_t last_sample = 0;
+                while (haptics_running) {
+                    //sleep until the tracking thread publishes, waking now and then to notice shutdown
+                    TrackedControllerState tracked = program->waitTrackedControllerState(hand,last_sample,std::chrono::milliseconds(10));
+                    if (tracked.sample == last_sample) continue;
+                    last_sample = tracked.sample;
+                    processController(tracked.state.location);
+                }
+            });
+        }
+
         bool exitRenderLoop = false;
         while (!exitRenderLoop) {
             program->PollEvents(&exitRenderLoop, &requestRestart);
@@ -91,63 +190,21 @@ int main(int argc, char* argv[]) {
             if (program->IsSessionRunning()) {
                 program->PollActions();
 
-
+                //Render, the tracking thread feeds the haptic loop when enabled
                 XrTime displayTime = program->RenderFrame();
-                XrSpaceLocation pos = program->getControllerSpace(displayTime,hand);
-
-                //convert openXR types to Eigen
-                Eigen::Quaternion<float,Eigen::AutoAlign> controller_orientation(pos.pose.orientation.w,pos.pose.orientation.x,pos.pose.orientation.y,pos.pose.orientation.z);
-                Eigen::Vector3f controller_position;
-                controller_position << pos.pose.position.x, pos.pose.position.y, pos.pose.position.z;
-
-                //create Rotate identity matrix by quaternion
-                Eigen::Transform<float,3,Eigen::Affine> Twc;
-                Twc.setIdentity();
-                Twc.rotate(controller_orientation);
-
-                //compute rotation about y axis in degrees
-                float ang = atan2(Twc.rotation()(0,0),Twc.rotation()(2,0))*(180/geometry::PI);
-                std::cout << ang << std::endl;
-                
-
-                //get encoder data
-                odrive.updateEncoderReadings(0);
-                const double theta = odrive.getEncoderPosition()*360;
-
-                //get motor current
-                odrive.updateMotorCurrent(0);
-                double current = odrive.getCurrent();
-
-                //spring displacement
-                double displacement = 0;
-
-                //engage spring
-                if (ang > 0 && ang < 90) {
-
-                    //calculate and clamp torque
-                    torque = k*ang;
-                    torque = std::max(0.0,std::min(torque,0.5));
-
-                    //command motor
-                    odrive.sendTorqueCommand(0,-torque);
-                }
-
-                //deactivate spring
-                else odrive.sendTorqueCommand(0,0);
-
-                //track time
-                std::chrono::steady_clock::time_point loop_stop = std::chrono::steady_clock::now();
-                double time_stamp = std::chrono::duration_cast<std::chrono::duration<double>>(loop_stop-program_start).count();
-
-                 //write to csv
-                if (loggingEnabled) {
-                    datafile << time_stamp << "," << current << "," << torque << "," << ang << "," << theta << "\n";
+                if (tracking_rate <= 0) {
+                    processController(program->getControllerSpace(displayTime,hand));
                 }
             }
             // Throttle loop since xrWaitFrame won't be called.
             else std::this_thread::sleep_for(std::chrono::milliseconds(250));
         }
 
+        //Stop the haptic loop before the program goes away
+        haptics_running = false;
+        if (haptic_thread.joinable()) haptic_thread.join();
+        program->stopTracking();
+
     } while (requestRestart);
 
 }
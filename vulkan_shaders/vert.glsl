@@ -9,12 +9,15 @@
 
 layout (std140, push_constant) uniform buf
 {
-    mat4 mvp;
+    mat4 viewProj;
 } ubuf;
 
 layout (location = 0) in vec3 Position;
 layout (location = 1) in vec3 Color;
 
+// Per-instance model transform, occupies locations 2 to 5.
+layout (location = 2) in mat4 Model;
+
 layout (location = 0) out vec4 oColor;
 out gl_PerVertex
 {
@@ -25,5 +28,5 @@ void main()
 {
     oColor.rgb  = Color.rgb;
     oColor.a  = 1.0;
-    gl_Position = ubuf.mvp * vec4(Position, 1);
+    gl_Position = ubuf.viewProj * (Model * vec4(Position, 1));
 }